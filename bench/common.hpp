@@ -0,0 +1,74 @@
+#pragma once
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "counters.hpp"
+
+// Workload shared by all benchmark executables, so the versions are measured on the same data.
+namespace bench {
+
+struct Position {
+    float x, y;
+};
+
+struct Velocity {
+    float dx, dy;
+};
+
+struct Acceleration {
+    float ax, ay;
+};
+
+struct Mass {
+    float m;
+};
+
+// Empty tag components. Entity i gets Tag<i % fragmentation>, which spreads the entities over
+// `fragmentation` archetypes.
+template <std::size_t N>
+struct Tag {};
+
+inline constexpr std::size_t maxFragmentation = 16;
+
+// Seed of all random numbers, every run sees the same workload.
+inline constexpr unsigned seed = 42;
+
+// Entity counts (1k - 10M) times archetype fragmentation.
+inline void entityArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"entities", "archetypes"});
+    b->ArgsProduct({{1'000, 10'000, 100'000, 1'000'000, 10'000'000}, {1, 4, maxFragmentation}});
+    b->Unit(benchmark::kMicrosecond);
+}
+
+// Calls func.template operator()<N>() with N == index, maps a runtime tag index to Tag<N>.
+template <typename Func>
+void withTag(std::size_t index, Func&& func) {
+    [&]<std::size_t... Ns>(std::index_sequence<Ns...>) {
+        ((index == Ns ? (func.template operator()<Ns>(), true) : false) || ...);
+    }(std::make_index_sequence<maxFragmentation>{});
+}
+
+// Returns `count` values 0..count-1 in a random order.
+template <typename Id>
+std::vector<Id> shuffledIds(std::size_t count) {
+    std::vector<Id> ids(count);
+    std::iota(ids.begin(), ids.end(), Id{0});
+    std::shuffle(ids.begin(), ids.end(), std::mt19937{seed});
+    return ids;
+}
+
+inline Position makePosition(std::size_t i) { return Position{float(i % 1000), float(i / 1000)}; }
+inline Velocity makeVelocity(std::size_t i) { return Velocity{1.0f, float(i % 7) - 3.0f}; }
+
+// Reports entities per second for a benchmark that touches `entities` entities per iteration.
+inline void setEntitiesProcessed(benchmark::State& state, std::size_t entities) {
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * entities));
+}
+
+}  // namespace bench
@@ -0,0 +1,168 @@
+#pragma once
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware performance counters of the benchmark loops, read with perf_event_open on Linux. Off
+// unless the environment variable ECS_BENCH_COUNTERS is set (to anything but 0):
+//
+//   ECS_BENCH_COUNTERS=1 ./EntityComponentSystem_bench_v5 --benchmark_filter=ForEach
+//
+// Every benchmark that wraps its loop in HardwareCounters reports cycles, instructions, L1d, LLC,
+// dTLB and branch misses per iteration and per entity (e.g. "L1d_misses/entity"). The counters
+// count the thread of the benchmark in user space over the whole loop, so they are only used in
+// loops that neither pause the timer nor hand work to other threads. Events the CPU or the kernel
+// does not provide (virtual machines, perf_event_paranoid > 2) are left out with a note on stderr.
+namespace bench {
+
+class HardwareCounters {
+   public:
+    // Starts counting, call right before the benchmark loop.
+    explicit HardwareCounters(benchmark::State& state) : state(state) {
+        Events& events = Events::instance();
+        if (events.active()) events.start();
+    }
+
+    // Stops counting and adds the counters of the loop to the benchmark. `entities` is the
+    // number of entities one iteration processes, as for setEntitiesProcessed.
+    void stop(std::size_t entities) {
+        Events& events = Events::instance();
+        if (!events.active()) return;
+        auto totals = events.stop();
+        for (std::size_t e = 0; e < eventCount; ++e) {
+            if (!events.opened(e)) continue;
+            std::string name = eventNames[e];
+            double total = totals[e];
+            state.counters[name] = benchmark::Counter(total, benchmark::Counter::kAvgIterations);
+            state.counters[name + "/entity"] = benchmark::Counter(
+                entities > 0 ? total / double(entities) : 0.0, benchmark::Counter::kAvgIterations);
+        }
+        if (events.opened(cycles) && events.opened(instructions) && totals[cycles] > 0) {
+            state.counters["IPC"] = totals[instructions] / totals[cycles];
+        }
+    }
+
+   private:
+    enum Event { cycles, instructions, l1dMisses, llcMisses, dtlbMisses, branchMisses, eventCount };
+
+    static constexpr const char* eventNames[eventCount] = {
+        "cycles", "instructions", "L1d_misses", "LLC_misses", "dTLB_misses", "branch_misses",
+    };
+
+    // The counters of the calling thread, opened on first use.
+    class Events {
+       public:
+        static Events& instance() {
+            thread_local Events events;
+            return events;
+        }
+
+        Events(const Events&) = delete;
+        Events& operator=(const Events&) = delete;
+
+        ~Events() {
+#if defined(__linux__)
+            for (int fd : fds) {
+                if (fd >= 0) close(fd);
+            }
+#endif
+        }
+
+        bool active() const { return enabled && open > 0; }
+        bool opened(std::size_t e) const { return fds[e] >= 0; }
+
+        void start() {
+#if defined(__linux__)
+            for (int fd : fds) {
+                if (fd < 0) continue;
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+        }
+
+        // Counts since start, scaled up when the kernel multiplexed an event with others.
+        std::array<double, eventCount> stop() {
+            std::array<double, eventCount> totals{};
+#if defined(__linux__)
+            for (int fd : fds) {
+                if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+            for (std::size_t e = 0; e < eventCount; ++e) {
+                // value, time enabled, time running
+                uint64_t values[3] = {};
+                if (fds[e] < 0 || read(fds[e], values, sizeof(values)) != ssize_t(sizeof(values))) {
+                    continue;
+                }
+                totals[e] = values[2] > 0 ? double(values[0]) * values[1] / values[2] : 0.0;
+            }
+#endif
+            return totals;
+        }
+
+       private:
+        std::array<int, eventCount> fds;
+        std::size_t open = 0;
+        bool enabled = false;
+
+        Events() {
+            fds.fill(-1);
+            const char* setting = std::getenv("ECS_BENCH_COUNTERS");
+            enabled = setting && *setting && std::strcmp(setting, "0") != 0;
+            if (!enabled) return;
+#if defined(__linux__)
+            auto cache = [](uint64_t type, uint64_t result) {
+                return type | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (result << 16);
+            };
+            const std::array<std::pair<uint32_t, uint64_t>, eventCount> configs = {{
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+                {PERF_TYPE_HW_CACHE,
+                 cache(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+                {PERF_TYPE_HW_CACHE,
+                 cache(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+                {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            }};
+            for (std::size_t e = 0; e < eventCount; ++e) {
+                perf_event_attr attr{};
+                attr.size = sizeof(attr);
+                attr.type = configs[e].first;
+                attr.config = configs[e].second;
+                attr.disabled = 1;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                // This thread on any CPU
+                fds[e] = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+                if (fds[e] >= 0) {
+                    ++open;
+                } else {
+                    std::fprintf(stderr, "ECS_BENCH_COUNTERS: %s unavailable (%s)\n",
+                                 eventNames[e], std::strerror(errno));
+                }
+            }
+#else
+            std::fprintf(stderr, "ECS_BENCH_COUNTERS: hardware counters need Linux\n");
+#endif
+        }
+    };
+
+    benchmark::State& state;
+};
+
+}  // namespace bench
@@ -0,0 +1,139 @@
+#include <memory>
+
+#include "common.hpp"
+
+using namespace bench;
+
+// Object oriented baseline in the style of example/oop: every entity is a heap object behind a
+// base class pointer and systems are virtual calls. The id of an entity is its index in the list.
+// Entity i is of class Body<i % fragmentation>, so fragmentation is the number of classes.
+// Adding or removing components has no counterpart and is not measured.
+namespace {
+
+class Entity {
+   public:
+    Entity(Position pos, Velocity vel) : position(pos), velocity(vel) {}
+    virtual ~Entity() = default;
+
+    virtual void touchPosition() = 0;
+    virtual void move() = 0;
+    virtual void accelerate() = 0;
+
+    Position position;
+    Velocity velocity;
+    Acceleration acceleration{0.0f, -1.0f};
+    Mass mass{1.0f};
+};
+
+template <std::size_t N>
+class Body : public Entity {
+   public:
+    using Entity::Entity;
+
+    void touchPosition() override { position.x += 1.0f; }
+
+    void move() override {
+        position.x += velocity.dx;
+        position.y += velocity.dy;
+    }
+
+    void accelerate() override {
+        velocity.dx += acceleration.ax / mass.m;
+        velocity.dy += acceleration.ay / mass.m;
+        move();
+    }
+};
+
+using EntityList = std::vector<std::unique_ptr<Entity>>;
+
+void populate(EntityList& entities, std::size_t count, std::size_t fragmentation) {
+    entities.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+        withTag(i % fragmentation, [&]<std::size_t N>() {
+            entities.push_back(std::make_unique<Body<N>>(makePosition(i), makeVelocity(i)));
+        });
+    }
+}
+
+void BM_Create(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    for (auto _ : state) {
+        EntityList entities;
+        populate(entities, count, fragmentation);
+        state.PauseTiming();
+        entities.clear();
+        state.ResumeTiming();
+    }
+    setEntitiesProcessed(state, count);
+}
+
+void BM_Destroy(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    auto ids = shuffledIds<std::size_t>(count);
+    for (auto _ : state) {
+        state.PauseTiming();
+        EntityList entities;
+        populate(entities, count, fragmentation);
+        state.ResumeTiming();
+        for (std::size_t id : ids) entities[id].reset();
+    }
+    setEntitiesProcessed(state, count);
+}
+
+void BM_ApplyRandom(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    EntityList entities;
+    populate(entities, count, fragmentation);
+    auto ids = shuffledIds<std::size_t>(count);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        for (std::size_t id : ids) entities[id]->position.x += entities[id]->velocity.dx;
+    }
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+void BM_ForEach1(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    EntityList entities;
+    populate(entities, count, fragmentation);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        for (auto& entity : entities) entity->touchPosition();
+    }
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+void BM_ForEach2(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    EntityList entities;
+    populate(entities, count, fragmentation);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        for (auto& entity : entities) entity->move();
+    }
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+void BM_ForEach4(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    EntityList entities;
+    populate(entities, count, fragmentation);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        for (auto& entity : entities) entity->accelerate();
+    }
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+}  // namespace
+
+BENCHMARK(BM_Create)->Apply(entityArgs);
+BENCHMARK(BM_Destroy)->Apply(entityArgs);
+BENCHMARK(BM_ApplyRandom)->Apply(entityArgs);
+BENCHMARK(BM_ForEach1)->Apply(entityArgs);
+BENCHMARK(BM_ForEach2)->Apply(entityArgs);
+BENCHMARK(BM_ForEach4)->Apply(entityArgs);
@@ -0,0 +1,267 @@
+// Perf regression gate, registered with CTest as perf_gate (see CMakeLists.txt).
+// Runs the v5 benchmarks listed in a baseline file with warmup and repetitions and compares their
+// medians with the baseline. Medians are related to the median of a reference benchmark, a plain
+// loop over two vectors, so a baseline written on one machine holds on another one as long as
+// the ECS costs the same relative to memory bandwidth.
+//
+//   EntityComponentSystem_perf_gate --baseline=bench/perf_baseline.txt [--tolerance=0.25]
+//                                   [--update] [--benchmark_...]
+//
+// A benchmark fails when its median relative to the reference is more than its tolerance above
+// the baseline. --tolerance replaces the default tolerance of the baseline, tolerances of single
+// benchmarks stay. --update runs the benchmarks and writes their medians into the baseline.
+// Further flags go to Google Benchmark and override the defaults of the gate.
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Defaults of the gate: warmup, 9 samples per benchmark, only the statistics on the console. The
+// samples of all benchmarks are interleaved, so load on the machine hits the reference as much
+// as the others and cancels out in the ratios.
+const char* const defaultFlags[] = {
+    "--benchmark_min_warmup_time=0.1",
+    "--benchmark_min_time=0.05",
+    "--benchmark_repetitions=9",
+    "--benchmark_enable_random_interleaving=true",
+    "--benchmark_display_aggregates_only=true",
+};
+
+// A line of the baseline file, either an entry or a line that is kept as it is.
+struct Line {
+    std::string text;
+    bool entry = false;
+    std::string name;
+    // Median in ns, only informative since it depends on the machine
+    double nanoseconds = 0.0;
+    // Median relative to the median of the reference
+    double ratio = 0.0;
+    std::optional<double> tolerance;
+};
+
+// Baseline file, one entry per line:
+//   reference <benchmark> <median ns>
+//   tolerance <default tolerance, 0.25 = 25 %>
+//   <benchmark> <median ns> <median / reference median> [<tolerance>]
+// Empty lines and lines starting with # are comments.
+struct Baseline {
+    std::vector<Line> lines;
+    std::string reference;
+    double referenceNanoseconds = 0.0;
+    double tolerance = 0.25;
+};
+
+bool readBaseline(const std::string& path, Baseline& baseline) {
+    std::ifstream file(path);
+    if (!file) {
+        std::fprintf(stderr, "perf gate: cannot read baseline %s\n", path.c_str());
+        return false;
+    }
+    std::string text;
+    for (size_t number = 1; std::getline(file, text); ++number) {
+        Line line;
+        line.text = text;
+        std::istringstream fields(text);
+        std::string first;
+        if (!(fields >> first) || first[0] == '#') {
+            baseline.lines.push_back(line);
+            continue;
+        }
+        bool valid;
+        if (first == "reference") {
+            valid = bool(fields >> baseline.reference >> baseline.referenceNanoseconds);
+        } else if (first == "tolerance") {
+            valid = bool(fields >> baseline.tolerance);
+        } else {
+            line.entry = true;
+            line.name = first;
+            valid = bool(fields >> line.nanoseconds >> line.ratio);
+            if (double tolerance; valid && fields >> tolerance) line.tolerance = tolerance;
+        }
+        if (!valid) {
+            std::fprintf(stderr, "perf gate: %s:%zu: cannot parse '%s'\n", path.c_str(), number,
+                         text.c_str());
+            return false;
+        }
+        baseline.lines.push_back(line);
+    }
+    if (baseline.reference.empty()) {
+        std::fprintf(stderr, "perf gate: %s names no reference benchmark\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool writeBaseline(const std::string& path, const Baseline& baseline,
+                   const std::map<std::string, double>& medians) {
+    std::ofstream file(path);
+    for (const Line& line : baseline.lines) {
+        std::istringstream fields(line.text);
+        std::string first;
+        fields >> first;
+        double reference = medians.at(baseline.reference);
+        char buffer[512];
+        if (line.entry) {
+            double median = medians.at(line.name);
+            int length = std::snprintf(buffer, sizeof(buffer), "%s %.0f %.4f", line.name.c_str(),
+                                       median, median / reference);
+            if (line.tolerance) {
+                std::snprintf(buffer + length, sizeof(buffer) - length, " %g", *line.tolerance);
+            }
+            file << buffer << '\n';
+        } else if (first == "reference") {
+            std::snprintf(buffer, sizeof(buffer), "reference %s %.0f", baseline.reference.c_str(),
+                          reference);
+            file << buffer << '\n';
+        } else {
+            file << line.text << '\n';
+        }
+    }
+    return bool(file);
+}
+
+// Shows the runs like the console reporter and keeps the median CPU time of every benchmark.
+class MedianReporter : public benchmark::ConsoleReporter {
+   public:
+    std::map<std::string, double> medians;
+
+    void ReportRuns(const std::vector<Run>& runs) override {
+        ConsoleReporter::ReportRuns(runs);
+        for (const Run& run : runs) {
+            if (run.run_type != Run::RT_Aggregate || run.aggregate_name != "median") continue;
+            medians[run.run_name.str()] =
+                run.GetAdjustedCPUTime() * 1e9 / benchmark::GetTimeUnitMultiplier(run.time_unit);
+        }
+    }
+};
+
+// Regex that matches exactly the given benchmarks.
+std::string filterOf(const Baseline& baseline) {
+    std::string filter = "^(" + baseline.reference;
+    for (const Line& line : baseline.lines) {
+        if (line.entry) filter += "|" + line.name;
+    }
+    return filter + ")$";
+}
+
+std::string percent(double fraction) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%+.1f %%", fraction * 100.0);
+    return buffer;
+}
+
+// Prints the comparison table and returns the number of regressions.
+int compare(const Baseline& baseline, const std::map<std::string, double>& medians,
+            const std::string& path) {
+    double reference = medians.at(baseline.reference);
+    size_t width = baseline.reference.size();
+    for (const Line& line : baseline.lines) {
+        if (line.entry) width = std::max(width, line.name.size());
+    }
+    int w = int(width);
+
+    std::printf("\nperf gate: medians relative to %s against %s\n", baseline.reference.c_str(),
+                path.c_str());
+    std::printf("%-*s %14s %14s %10s %10s %9s\n", w, "benchmark", "baseline ns", "median ns",
+                "baseline x", "median x", "change");
+    std::printf("%-*s %14.0f %14.0f %10s %10s %9s   reference\n", w, baseline.reference.c_str(),
+                baseline.referenceNanoseconds, reference, "1", "1",
+                percent(reference / baseline.referenceNanoseconds - 1.0).c_str());
+
+    int regressions = 0;
+    for (const Line& line : baseline.lines) {
+        if (!line.entry) continue;
+        double ratio = medians.at(line.name) / reference;
+        double change = ratio / line.ratio - 1.0;
+        double tolerance = line.tolerance.value_or(baseline.tolerance);
+        const char* verdict = "ok";
+        if (change > tolerance) {
+            verdict = "REGRESSION";
+            ++regressions;
+        } else if (change < -tolerance) {
+            verdict = "faster, consider --update";
+        }
+        std::printf("%-*s %14.0f %14.0f %10.3f %10.3f %9s   %s (tolerance %.0f %%)\n", w,
+                    line.name.c_str(), line.nanoseconds, medians.at(line.name), line.ratio, ratio,
+                    percent(change).c_str(), verdict, tolerance * 100.0);
+    }
+    if (regressions > 0) {
+        std::printf("\nperf gate: %d benchmark(s) regressed beyond their tolerance\n",
+                    regressions);
+    } else {
+        std::printf("\nperf gate: passed\n");
+    }
+    return regressions;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string path;
+    std::optional<double> tolerance;
+    bool update = false;
+    std::vector<char*> args{argv[0]};
+    for (const char* flag : defaultFlags) args.push_back(const_cast<char*>(flag));
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--baseline=", 0) == 0) {
+            path = arg.substr(11);
+        } else if (arg.rfind("--tolerance=", 0) == 0) {
+            // An empty value keeps the tolerance of the baseline, see ECS_PERF_TOLERANCE
+            if (arg.size() > 12) tolerance = std::atof(arg.c_str() + 12);
+        } else if (arg == "--update") {
+            update = true;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    if (path.empty()) {
+        std::fprintf(stderr, "usage: %s --baseline=<file> [--tolerance=<fraction>] [--update]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    Baseline baseline;
+    if (!readBaseline(path, baseline)) return 2;
+    if (tolerance) baseline.tolerance = *tolerance;
+
+    int count = int(args.size());
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data())) return 2;
+    MedianReporter reporter;
+    benchmark::RunSpecifiedBenchmarks(&reporter, filterOf(baseline));
+    benchmark::Shutdown();
+
+    bool complete = reporter.medians.count(baseline.reference) > 0;
+    if (!complete) {
+        std::fprintf(stderr, "perf gate: no median of the reference %s\n",
+                     baseline.reference.c_str());
+    }
+    for (const Line& line : baseline.lines) {
+        if (line.entry && !reporter.medians.count(line.name)) {
+            std::fprintf(stderr, "perf gate: no median of %s, is it registered in v5.cpp?\n",
+                         line.name.c_str());
+            complete = false;
+        }
+    }
+    if (!complete) return 2;
+
+    if (update) {
+        if (!writeBaseline(path, baseline, reporter.medians)) {
+            std::fprintf(stderr, "perf gate: cannot write baseline %s\n", path.c_str());
+            return 2;
+        }
+        std::printf("\nperf gate: wrote %s\n", path.c_str());
+        return 0;
+    }
+    return compare(baseline, reporter.medians, path) > 0 ? 1 : 0;
+}
@@ -0,0 +1,88 @@
+#include "../example/ecs/render.hpp"
+
+#include <functional>
+#include <random>
+
+#include "common.hpp"
+
+namespace {
+
+using World = ecs::World<MyECS>;
+
+// Scene of the ecs example: moving circles with one rectangle per 10 entities.
+void populate(World& world, std::size_t count) {
+    std::mt19937 rng(bench::seed);
+    std::uniform_real_distribution<float> coord(100.0f, 1000.0f);
+    std::uniform_int_distribution<int> channel(0, 255);
+    for (std::size_t i = 0; i < count; i++) {
+        Position pos{coord(rng), coord(rng)};
+        Color color{static_cast<unsigned char>(channel(rng)),
+                    static_cast<unsigned char>(channel(rng)),
+                    static_cast<unsigned char>(channel(rng)), 255};
+        if (i % 10 == 0) {
+            world.createEntity<Position, Rectangle, Color>(Position{pos}, Rectangle{10.0f, 20.0f},
+                                                           Color{color});
+        } else {
+            world.createEntity<Position, Circle, Color, Velocity>(
+                Position{pos}, Circle{10.0f}, Color{color}, Velocity{1.0f, 1.0f});
+        }
+    }
+}
+
+// The previous draw loop: one call per entity into the renderer, which appends the shape.
+void BM_DrawPerEntity(benchmark::State& state) {
+    std::size_t count = state.range(0);
+    World world;
+    populate(world, count);
+    std::vector<Instance> drawList;
+    std::function<void(const Instance&)> draw = [&](const Instance& instance) {
+        drawList.push_back(instance);
+    };
+    bench::HardwareCounters counters(state);
+    for (auto _ : state) {
+        drawList.clear();
+        world.forEach<Position, Circle, Color>([&](Position& pos, Circle& circle, Color& color) {
+            draw(Instance{pos.x, pos.y, circle.radius, circle.radius, packColor(color),
+                          Shape::Circle});
+        });
+        world.forEach<Position, Rectangle, Color>([&](Position& pos, Rectangle& rect,
+                                                     Color& color) {
+            draw(Instance{pos.x, pos.y, rect.length, rect.width, packColor(color),
+                          Shape::Rectangle});
+        });
+        benchmark::DoNotOptimize(drawList.data());
+    }
+    counters.stop(count);
+    bench::setEntitiesProcessed(state, count);
+}
+
+void BM_Extract(benchmark::State& state) {
+    std::size_t count = state.range(0);
+    std::size_t threads = state.range(1);
+    World world;
+    populate(world, count);
+    RenderExtraction extraction;
+    for (auto _ : state) {
+        extraction.extract(world, threads);
+        benchmark::DoNotOptimize(extraction.instances().data());
+    }
+    bench::setEntitiesProcessed(state, count);
+}
+
+void sceneArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"entities"});
+    b->Args({10'000})->Args({100'000})->Args({1'000'000});
+    b->Unit(benchmark::kMicrosecond);
+}
+
+void extractArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"entities", "threads"});
+    b->ArgsProduct({{10'000, 100'000, 1'000'000}, {1, 4}});
+    b->Unit(benchmark::kMicrosecond);
+    b->UseRealTime();
+}
+
+}  // namespace
+
+BENCHMARK(BM_DrawPerEntity)->Apply(sceneArgs);
+BENCHMARK(BM_Extract)->Apply(extractArgs);
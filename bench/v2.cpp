@@ -0,0 +1,301 @@
+#include "common.hpp"
+
+#include "../src/v2/ecs.hpp"
+
+#include <cstddef>
+
+using namespace bench;
+
+// v2 keeps one global sparse set per component type and has no archetypes, so fragmentation does
+// not apply.
+namespace {
+
+void v2Args(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"entities"});
+    b->Arg(1'000)->Arg(10'000)->Arg(100'000)->Arg(1'000'000)->Arg(10'000'000);
+    b->Unit(benchmark::kMicrosecond);
+}
+
+void reset() {
+    ecs::getStorage<Position>() = ecs::ComponentStorage<Position>{};
+    ecs::getStorage<Velocity>() = ecs::ComponentStorage<Velocity>{};
+    ecs::getStorage<Acceleration>() = ecs::ComponentStorage<Acceleration>{};
+    ecs::getStorage<Mass>() = ecs::ComponentStorage<Mass>{};
+    ecs::nextEntityId = 0;
+}
+
+// Creates `count` entities with all four data components, entity i has the id i.
+void populate(std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+        ecs::Entity e = ecs::createEntity();
+        ecs::addComponent(e, makePosition(i));
+        ecs::addComponent(e, makeVelocity(i));
+        ecs::addComponent(e, Acceleration{0.0f, -1.0f});
+        ecs::addComponent(e, Mass{1.0f});
+    }
+}
+
+void BM_Create(benchmark::State& state) {
+    std::size_t count = state.range(0);
+    for (auto _ : state) {
+        populate(count);
+        state.PauseTiming();
+        reset();
+        state.ResumeTiming();
+    }
+    setEntitiesProcessed(state, count);
+}
+
+void BM_Destroy(benchmark::State& state) {
+    std::size_t count = state.range(0);
+    auto ids = shuffledIds<int>(count);
+    for (auto _ : state) {
+        state.PauseTiming();
+        populate(count);
+        state.ResumeTiming();
+        for (int id : ids) {
+            ecs::getStorage<Position>().remove(id);
+            ecs::getStorage<Velocity>().remove(id);
+            ecs::getStorage<Acceleration>().remove(id);
+            ecs::getStorage<Mass>().remove(id);
+        }
+        state.PauseTiming();
+        reset();
+        state.ResumeTiming();
+    }
+    setEntitiesProcessed(state, count);
+}
+
+void BM_AddComponent(benchmark::State& state) {
+    std::size_t count = state.range(0);
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (std::size_t i = 0; i < count; i++) {
+            ecs::addComponent(ecs::createEntity(), makePosition(i));
+        }
+        state.ResumeTiming();
+        for (std::size_t i = 0; i < count; i++) {
+            ecs::addComponent(ecs::Entity{static_cast<int>(i)}, makeVelocity(i));
+        }
+        state.PauseTiming();
+        reset();
+        state.ResumeTiming();
+    }
+    setEntitiesProcessed(state, count);
+}
+
+void BM_RemoveComponent(benchmark::State& state) {
+    std::size_t count = state.range(0);
+    for (auto _ : state) {
+        state.PauseTiming();
+        populate(count);
+        state.ResumeTiming();
+        for (std::size_t i = 0; i < count; i++) {
+            ecs::getStorage<Velocity>().remove(static_cast<int>(i));
+        }
+        state.PauseTiming();
+        reset();
+        state.ResumeTiming();
+    }
+    setEntitiesProcessed(state, count);
+}
+
+void BM_ApplyRandom(benchmark::State& state) {
+    std::size_t count = state.range(0);
+    populate(count);
+    auto ids = shuffledIds<int>(count);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        for (int id : ids) {
+            Position* pos = ecs::getComponent<Position>(ecs::Entity{id});
+            Velocity* vel = ecs::getComponent<Velocity>(ecs::Entity{id});
+            pos->x += vel->dx;
+        }
+    }
+    counters.stop(count);
+    reset();
+    setEntitiesProcessed(state, count);
+}
+
+void BM_ForEach1(benchmark::State& state) {
+    std::size_t count = state.range(0);
+    populate(count);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        for (auto& pos : ecs::getStorage<Position>().getAllComponents()) pos.x += 1.0f;
+    }
+    counters.stop(count);
+    reset();
+    setEntitiesProcessed(state, count);
+}
+
+void BM_ForEach2(benchmark::State& state) {
+    std::size_t count = state.range(0);
+    populate(count);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        auto& positions = ecs::getStorage<Position>().getAllComponents();
+        auto& entities = ecs::getStorage<Position>().getAllEntities();
+        auto& velStorage = ecs::getStorage<Velocity>();
+        for (std::size_t i = 0; i < positions.size(); i++) {
+            Velocity* vel = velStorage.get(entities[i]);
+            if (!vel) continue;
+            positions[i].x += vel->dx;
+            positions[i].y += vel->dy;
+        }
+    }
+    counters.stop(count);
+    reset();
+    setEntitiesProcessed(state, count);
+}
+
+void BM_ForEach4(benchmark::State& state) {
+    std::size_t count = state.range(0);
+    populate(count);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        auto& positions = ecs::getStorage<Position>().getAllComponents();
+        auto& entities = ecs::getStorage<Position>().getAllEntities();
+        auto& velStorage = ecs::getStorage<Velocity>();
+        auto& accStorage = ecs::getStorage<Acceleration>();
+        auto& massStorage = ecs::getStorage<Mass>();
+        for (std::size_t i = 0; i < positions.size(); i++) {
+            Velocity* vel = velStorage.get(entities[i]);
+            Acceleration* acc = accStorage.get(entities[i]);
+            Mass* mass = massStorage.get(entities[i]);
+            if (!vel || !acc || !mass) continue;
+            vel->dx += acc->ax / mass->m;
+            vel->dy += acc->ay / mass->m;
+            positions[i].x += vel->dx;
+            positions[i].y += vel->dy;
+        }
+    }
+    counters.stop(count);
+    reset();
+    setEntitiesProcessed(state, count);
+}
+
+// BM_ForEach2 over an owning group: Position and Velocity of the members are packed at the front
+// of both storages in the same order, so the loop needs no sparse lookups.
+void BM_ForEach2Group(benchmark::State& state) {
+    std::size_t count = state.range(0);
+    populate(count);
+    {
+        ecs::Group<Position, Velocity> group;
+        HardwareCounters counters(state);
+        for (auto _ : state) {
+            group.each([](Position& pos, Velocity& vel) {
+                pos.x += vel.dx;
+                pos.y += vel.dy;
+            });
+        }
+        counters.stop(count);
+    }
+    reset();
+    setEntitiesProcessed(state, count);
+}
+
+// BM_ForEach4 over an owning group of all four components.
+void BM_ForEach4Group(benchmark::State& state) {
+    std::size_t count = state.range(0);
+    populate(count);
+    {
+        ecs::Group<Position, Velocity, Acceleration, Mass> group;
+        HardwareCounters counters(state);
+        for (auto _ : state) {
+            group.each([](Position& pos, Velocity& vel, Acceleration& acc, Mass& mass) {
+                vel.dx += acc.ax / mass.m;
+                vel.dy += acc.ay / mass.m;
+                pos.x += vel.dx;
+                pos.y += vel.dy;
+            });
+        }
+        counters.stop(count);
+    }
+    reset();
+    setEntitiesProcessed(state, count);
+}
+
+// Component types of BM_SparseLookup.
+template <std::size_t N>
+struct Sparse {
+    float value;
+};
+
+inline constexpr std::size_t sparseTypes = 100;
+
+// Calls func.template operator()<N>() for every N < sparseTypes.
+template <typename Func>
+void forEachSparseType(Func&& func) {
+    [&]<std::size_t... Ns>(std::index_sequence<Ns...>) {
+        (func.template operator()<Ns>(), ...);
+    }(std::make_index_sequence<sparseTypes>{});
+}
+
+// `ids` entity ids spread over 100 component types: the ids come in runs of 1024 (e.g. spawn
+// waves) and each run gets one random type, so every storage holds about 1% of the ids scattered
+// over the whole id range. Reports the memory of all sparse indices next to what dense arrays of
+// `ids` slots per type would take, and times lookups of which half hit a member.
+void BM_SparseLookup(benchmark::State& state) {
+    constexpr std::size_t run = 1024, lookupsPerType = 10'000;
+    std::size_t ids = state.range(0);
+    std::mt19937 rng{seed};
+    for (std::size_t first = 0; first < ids; first += run) {
+        std::size_t type = rng() % sparseTypes;
+        forEachSparseType([&]<std::size_t N>() {
+            if (N != type) return;
+            for (std::size_t id = first; id < std::min(first + run, ids); id++) {
+                ecs::getStorage<Sparse<N>>().add(static_cast<int>(id), Sparse<N>{1.0f});
+            }
+        });
+    }
+
+    std::size_t indexBytes = 0;
+    std::vector<std::vector<int>> lookups(sparseTypes);
+    forEachSparseType([&]<std::size_t N>() {
+        auto& storage = ecs::getStorage<Sparse<N>>();
+        indexBytes += storage.indexBytes();
+        for (std::size_t i = 0; i < lookupsPerType; i++) {
+            lookups[N].push_back(i % 2 == 0 || storage.dense.empty()
+                                     ? static_cast<int>(rng() % ids)
+                                     : storage.dense[rng() % storage.dense.size()]);
+        }
+    });
+
+    float sum = 0.0f;
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        forEachSparseType([&]<std::size_t N>() {
+            auto& storage = ecs::getStorage<Sparse<N>>();
+            for (int id : lookups[N]) {
+                if (Sparse<N>* component = storage.get(id)) sum += component->value;
+            }
+        });
+    }
+    counters.stop(sparseTypes * lookupsPerType);
+    benchmark::DoNotOptimize(sum);
+
+    forEachSparseType([&]<std::size_t N>() {
+        ecs::getStorage<Sparse<N>>() = ecs::ComponentStorage<Sparse<N>>{};
+    });
+    state.counters["index_MB"] = double(indexBytes) / (1 << 20);
+    state.counters["dense_index_MB"] = double(sparseTypes * ids * sizeof(int)) / (1 << 20);
+    setEntitiesProcessed(state, sparseTypes * lookupsPerType);
+}
+
+}  // namespace
+
+BENCHMARK(BM_Create)->Apply(v2Args);
+BENCHMARK(BM_Destroy)->Apply(v2Args);
+BENCHMARK(BM_AddComponent)->Apply(v2Args);
+BENCHMARK(BM_RemoveComponent)->Apply(v2Args);
+BENCHMARK(BM_ApplyRandom)->Apply(v2Args);
+BENCHMARK(BM_ForEach1)->Apply(v2Args);
+BENCHMARK(BM_ForEach2)->Apply(v2Args);
+BENCHMARK(BM_ForEach4)->Apply(v2Args);
+BENCHMARK(BM_ForEach2Group)->Apply(v2Args);
+BENCHMARK(BM_ForEach4Group)->Apply(v2Args);
+BENCHMARK(BM_SparseLookup)
+    ->Arg(10'000'000)
+    ->ArgName("ids")
+    ->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,89 @@
+#include "../src/v3/ecs.hpp"
+
+#include "common.hpp"
+
+using namespace bench;
+
+// v3 keeps all archetypes in globals and offers no apply, destroy or addComponent, only create
+// and forEach are measured. reset() clears the globals between runs.
+namespace {
+
+void reset() {
+    ecs::archetypes.clear();
+    ecs::archetypes.shrink_to_fit();
+    ecs::nextEntityId = 0;
+}
+
+// Creates `count` entities with all four data components, entity i gets Tag<i % fragmentation>.
+void populate(std::size_t count, std::size_t fragmentation) {
+    for (std::size_t i = 0; i < count; i++) {
+        withTag(i % fragmentation, [&]<std::size_t N>() {
+            ecs::createEntityWithComponents<Position, Velocity, Acceleration, Mass, Tag<N>>(
+                makePosition(i), makeVelocity(i), Acceleration{0.0f, -1.0f}, Mass{1.0f},
+                Tag<N>{});
+        });
+    }
+}
+
+void BM_Create(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    for (auto _ : state) {
+        populate(count, fragmentation);
+        state.PauseTiming();
+        reset();
+        state.ResumeTiming();
+    }
+    setEntitiesProcessed(state, count);
+}
+
+void BM_ForEach1(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    populate(count, fragmentation);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        ecs::forEach<Position>([](Position& pos) { pos.x += 1.0f; });
+    }
+    counters.stop(count);
+    reset();
+    setEntitiesProcessed(state, count);
+}
+
+void BM_ForEach2(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    populate(count, fragmentation);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        ecs::forEach<Position, Velocity>([](Position& pos, Velocity& vel) {
+            pos.x += vel.dx;
+            pos.y += vel.dy;
+        });
+    }
+    counters.stop(count);
+    reset();
+    setEntitiesProcessed(state, count);
+}
+
+void BM_ForEach4(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    populate(count, fragmentation);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        ecs::forEach<Position, Velocity, Acceleration, Mass>(
+            [](Position& pos, Velocity& vel, Acceleration& acc, Mass& mass) {
+                vel.dx += acc.ax / mass.m;
+                vel.dy += acc.ay / mass.m;
+                pos.x += vel.dx;
+                pos.y += vel.dy;
+            });
+    }
+    counters.stop(count);
+    reset();
+    setEntitiesProcessed(state, count);
+}
+
+}  // namespace
+
+BENCHMARK(BM_Create)->Apply(entityArgs);
+BENCHMARK(BM_ForEach1)->Apply(entityArgs);
+BENCHMARK(BM_ForEach2)->Apply(entityArgs);
+BENCHMARK(BM_ForEach4)->Apply(entityArgs);
@@ -0,0 +1,112 @@
+#include "../src/v4/ecs.hpp"
+
+#include <memory>
+
+#include "common.hpp"
+
+using namespace bench;
+
+// v4 has no destroyEntity and addComponent is unfinished, only create, apply and forEach are
+// measured. Its EntityLocation points into the archetype vector and dangles once a second
+// archetype is created, so all entities are kept in one archetype.
+namespace {
+
+void v4Args(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"entities", "archetypes"});
+    b->ArgsProduct({{1'000, 10'000, 100'000, 1'000'000, 10'000'000}, {1}});
+    b->Unit(benchmark::kMicrosecond);
+}
+
+// Creates `count` entities with all four data components, entity i gets Tag<i % fragmentation>.
+void populate(ecs::World& world, std::size_t count, std::size_t fragmentation) {
+    for (std::size_t i = 0; i < count; i++) {
+        withTag(i % fragmentation, [&]<std::size_t N>() {
+            world.createEntity<Position, Velocity, Acceleration, Mass, Tag<N>>(
+                makePosition(i), makeVelocity(i), Acceleration{0.0f, -1.0f}, Mass{1.0f},
+                Tag<N>{});
+        });
+    }
+}
+
+void BM_Create(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto world = std::make_unique<ecs::World>();
+        state.ResumeTiming();
+        populate(*world, count, fragmentation);
+        state.PauseTiming();
+        world.reset();
+        state.ResumeTiming();
+    }
+    setEntitiesProcessed(state, count);
+}
+
+void BM_ApplyRandom(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    ecs::World world;
+    populate(world, count, fragmentation);
+    auto ids = shuffledIds<ecs::EntityId>(count);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        for (ecs::EntityId id : ids) {
+            world.apply<Position, Velocity>(
+                id, [](Position& pos, Velocity& vel) { pos.x += vel.dx; });
+        }
+    }
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+void BM_ForEach1(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    ecs::World world;
+    populate(world, count, fragmentation);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        world.forEach<Position>([](Position& pos) { pos.x += 1.0f; });
+    }
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+void BM_ForEach2(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    ecs::World world;
+    populate(world, count, fragmentation);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        world.forEach<Position, Velocity>([](Position& pos, Velocity& vel) {
+            pos.x += vel.dx;
+            pos.y += vel.dy;
+        });
+    }
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+void BM_ForEach4(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    ecs::World world;
+    populate(world, count, fragmentation);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        world.forEach<Position, Velocity, Acceleration, Mass>(
+            [](Position& pos, Velocity& vel, Acceleration& acc, Mass& mass) {
+                vel.dx += acc.ax / mass.m;
+                vel.dy += acc.ay / mass.m;
+                pos.x += vel.dx;
+                pos.y += vel.dy;
+            });
+    }
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+}  // namespace
+
+BENCHMARK(BM_Create)->Apply(v4Args);
+BENCHMARK(BM_ApplyRandom)->Apply(v4Args);
+BENCHMARK(BM_ForEach1)->Apply(v4Args);
+BENCHMARK(BM_ForEach2)->Apply(v4Args);
+BENCHMARK(BM_ForEach4)->Apply(v4Args);
@@ -0,0 +1,692 @@
+#include "../src/v5/ecs.hpp"
+#include "../src/v5/scheduler.hpp"
+#include "../src/v5/sharded.hpp"
+
+#include <algorithm>
+#include <execution>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "common.hpp"
+
+using namespace bench;
+
+namespace {
+
+template <typename Sequence>
+struct TaggedComponentList;
+
+template <std::size_t... Ns>
+struct TaggedComponentList<std::index_sequence<Ns...>> {
+    using type = std::tuple<Position, Velocity, Acceleration, Mass, Tag<Ns>...>;
+};
+
+struct BenchConfig {
+    using ComponentList =
+        typename TaggedComponentList<std::make_index_sequence<maxFragmentation>>::type;
+};
+
+using World = ecs::World<ecs::ComponentManager<BenchConfig>>;
+using ShardedWorld = ecs::ShardedWorld<ecs::ComponentManager<BenchConfig>>;
+
+// Creates `count` entities with all four data components, entity i gets Tag<i % fragmentation>.
+// Ids are handed out per world starting at 0, so entity i has the id i.
+void populate(World& world, std::size_t count, std::size_t fragmentation) {
+    for (std::size_t i = 0; i < count; i++) {
+        withTag(i % fragmentation, [&]<std::size_t N>() {
+            world.createEntity<Position, Velocity, Acceleration, Mass, Tag<N>>(
+                makePosition(i), makeVelocity(i), Acceleration{0.0f, -1.0f}, Mass{1.0f},
+                Tag<N>{});
+        });
+    }
+}
+
+void BM_Create(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto world = std::make_unique<World>();
+        state.ResumeTiming();
+        populate(*world, count, fragmentation);
+        state.PauseTiming();
+        world.reset();
+        state.ResumeTiming();
+    }
+    setEntitiesProcessed(state, count);
+}
+
+void BM_Destroy(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    auto ids = shuffledIds<ecs::EntityId>(count);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto world = std::make_unique<World>();
+        populate(*world, count, fragmentation);
+        state.ResumeTiming();
+        for (ecs::EntityId id : ids) world->destroyEntity(id);
+        state.PauseTiming();
+        world.reset();
+        state.ResumeTiming();
+    }
+    setEntitiesProcessed(state, count);
+}
+
+void BM_AddComponent(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto world = std::make_unique<World>();
+        for (std::size_t i = 0; i < count; i++) {
+            withTag(i % fragmentation, [&]<std::size_t N>() {
+                world->createEntity<Position, Tag<N>>(makePosition(i), Tag<N>{});
+            });
+        }
+        state.ResumeTiming();
+        for (std::size_t tag = 0; tag < fragmentation; tag++) {
+            withTag(tag, [&]<std::size_t N>() {
+                for (std::size_t id = tag; id < count; id += fragmentation) {
+                    world->addComponent<Position, Velocity, Tag<N>>(
+                        static_cast<ecs::EntityId>(id), makeVelocity(id));
+                }
+            });
+        }
+        state.PauseTiming();
+        world.reset();
+        state.ResumeTiming();
+    }
+    setEntitiesProcessed(state, count);
+}
+
+// Same change as BM_AddComponent with one addComponentToAll call.
+void BM_AddComponentToAll(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto world = std::make_unique<World>();
+        for (std::size_t i = 0; i < count; i++) {
+            withTag(i % fragmentation, [&]<std::size_t N>() {
+                world->createEntity<Position, Tag<N>>(makePosition(i), Tag<N>{});
+            });
+        }
+        state.ResumeTiming();
+        world->addComponentToAll<Position, Velocity>(Velocity{1.0f, 0.0f});
+        state.PauseTiming();
+        world.reset();
+        state.ResumeTiming();
+    }
+    setEntitiesProcessed(state, count);
+}
+
+void BM_RemoveComponentFromAll(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto world = std::make_unique<World>();
+        populate(*world, count, fragmentation);
+        state.ResumeTiming();
+        world->removeComponentFromAll<Velocity>();
+        state.PauseTiming();
+        world.reset();
+        state.ResumeTiming();
+    }
+    setEntitiesProcessed(state, count);
+}
+
+// Same change as BM_RemoveComponentFromAll, one entity at a time.
+void BM_RemoveComponent(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    auto ids = shuffledIds<ecs::EntityId>(count);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto world = std::make_unique<World>();
+        populate(*world, count, fragmentation);
+        state.ResumeTiming();
+        for (ecs::EntityId id : ids) world->removeComponent<Velocity>(id);
+        state.PauseTiming();
+        world.reset();
+        state.ResumeTiming();
+    }
+    setEntitiesProcessed(state, count);
+}
+
+// BM_Create with an OnAdd observer on Position and Velocity, delivered by one sync.
+void BM_CreateObserved(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto world = std::make_unique<World>();
+        float sum = 0.0f;
+        world->observe<ecs::ObserverEvent::OnAdd, Position, Velocity>(
+            [&](std::span<const ecs::EntityId>, std::span<const Position> positions,
+                std::span<const Velocity>) {
+                for (const auto& pos : positions) sum += pos.x;
+            });
+        state.ResumeTiming();
+        populate(*world, count, fragmentation);
+        world->sync();
+        benchmark::DoNotOptimize(sum);
+        state.PauseTiming();
+        world.reset();
+        state.ResumeTiming();
+    }
+    setEntitiesProcessed(state, count);
+}
+
+void BM_ApplyRandom(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    World world;
+    populate(world, count, fragmentation);
+    auto ids = shuffledIds<ecs::EntityId>(count);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        for (ecs::EntityId id : ids) {
+            world.apply<Position, const Velocity>(
+                id, [](Position& pos, const Velocity& vel) { pos.x += vel.dx; });
+        }
+    }
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+// Same access pattern as BM_ApplyRandom through EntityRef handles created up front.
+void BM_RefRandom(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    World world;
+    populate(world, count, fragmentation);
+    std::vector<World::EntityRef<Position, const Velocity>> refs;
+    for (ecs::EntityId id : shuffledIds<ecs::EntityId>(count)) {
+        refs.push_back(world.ref<Position, const Velocity>(id));
+    }
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        for (auto& ref : refs) {
+            ref.apply([](Position& pos, const Velocity& vel) { pos.x += vel.dx; });
+        }
+    }
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+// Same access pattern as BM_ApplyRandom through one applyBatch call per iteration.
+void BM_ApplyBatchRandom(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    World world;
+    populate(world, count, fragmentation);
+    auto ids = shuffledIds<ecs::EntityId>(count);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        world.applyBatch<Position, const Velocity>(
+            ids, [](Position& pos, const Velocity& vel) { pos.x += vel.dx; }, state.range(2));
+    }
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+// Batches of 10k - 100k random ids, with and without prefetching.
+void batchArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"entities", "archetypes", "prefetch"});
+    b->ArgsProduct({{10'000, 100'000}, {1, maxFragmentation}, {0, 8}});
+    b->Unit(benchmark::kMicrosecond);
+}
+
+// Copy-on-write fork of the world: copies the chunk pointers and shares the chunks. clone_bytes
+// is the memory the fork does not share with the world (its chunk tables), world_bytes all the
+// world allocated, both from World::stats.
+void BM_Clone(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    World world;
+    populate(world, count, fragmentation);
+    std::size_t cloneBytes = 0;
+    for (auto _ : state) {
+        auto fork = std::make_unique<World>(world.clone());
+        state.PauseTiming();
+        ecs::WorldStats stats = fork->stats();
+        cloneBytes = stats.bytesTotal() - stats.bytesShared();
+        fork.reset();
+        state.ResumeTiming();
+    }
+    state.counters["clone_bytes"] = double(cloneBytes);
+    state.counters["world_bytes"] = double(world.stats().bytesTotal());
+    setEntitiesProcessed(state, count);
+}
+
+void cloneArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"entities", "archetypes"});
+    b->ArgsProduct({{100'000}, {1, maxFragmentation}});
+    b->Unit(benchmark::kMicrosecond);
+}
+
+void BM_ForEach1(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    World world;
+    populate(world, count, fragmentation);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        world.forEach<Position>([](Position& pos) { pos.x += 1.0f; });
+    }
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+void BM_ForEach2(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    World world;
+    populate(world, count, fragmentation);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        world.forEach<Position, const Velocity>([](Position& pos, const Velocity& vel) {
+            pos.x += vel.dx;
+            pos.y += vel.dy;
+        });
+    }
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+// The loop of BM_ForEach2 over two plain vectors, i.e. without the ECS. The perf gate
+// (perf_gate.cpp) relates the other benchmarks to it to factor out the machine.
+void BM_ReferenceLoop(benchmark::State& state) {
+    std::size_t count = state.range(0);
+    std::vector<Position> positions(count);
+    std::vector<Velocity> velocities(count);
+    for (std::size_t i = 0; i < count; i++) {
+        positions[i] = makePosition(i);
+        velocities[i] = makeVelocity(i);
+    }
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < count; i++) {
+            positions[i].x += velocities[i].dx;
+            positions[i].y += velocities[i].dy;
+        }
+        benchmark::ClobberMemory();
+    }
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+void referenceArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"entities"});
+    b->RangeMultiplier(10)->Range(1'000, 10'000'000);
+    b->Unit(benchmark::kMicrosecond);
+}
+
+void BM_ForEach4(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    World world;
+    populate(world, count, fragmentation);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        world.forEach<Position, Velocity, const Acceleration, const Mass>(
+            [](Position& pos, Velocity& vel, const Acceleration& acc, const Mass& mass) {
+                vel.dx += acc.ax / mass.m;
+                vel.dy += acc.ay / mass.m;
+                pos.x += vel.dx;
+                pos.y += vel.dy;
+            });
+    }
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+// Three systems of a frame: accelerate, move and sum up the kinetic energy.
+auto accelerate = [](Velocity& vel, const Acceleration& acc, const Mass& mass) {
+    vel.dx += acc.ax / mass.m;
+    vel.dy += acc.ay / mass.m;
+};
+auto move = [](Position& pos, const Velocity& vel) {
+    pos.x += vel.dx;
+    pos.y += vel.dy;
+};
+
+// The three systems as separate forEach passes.
+void BM_SeparatePasses(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    World world;
+    populate(world, count, fragmentation);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        float energy = 0.0f;
+        world.forEach<Velocity, const Acceleration, const Mass>(accelerate);
+        world.forEach<Position, const Velocity>(move);
+        world.forEach<const Velocity, const Mass>([&](const Velocity& vel, const Mass& mass) {
+            energy += 0.5f * mass.m * (vel.dx * vel.dx + vel.dy * vel.dy);
+        });
+        benchmark::DoNotOptimize(energy);
+    }
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+// The same systems in one forEachFused pass.
+void BM_FusedPasses(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    World world;
+    populate(world, count, fragmentation);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        float energy = 0.0f;
+        world.forEachFused(
+            ecs::makeSystem<Velocity, const Acceleration, const Mass>(accelerate),
+            ecs::makeSystem<Position, const Velocity>(move),
+            ecs::makeSystem<const Velocity, const Mass>([&](const Velocity& vel, const Mass& mass) {
+                energy += 0.5f * mass.m * (vel.dx * vel.dx + vel.dy * vel.dy);
+            }));
+        benchmark::DoNotOptimize(energy);
+    }
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+// BM_Create from `threads` worker threads, each with its own Spawner, followed by the sync that
+// splices the staged rows into the world.
+void BM_SpawnThreads(benchmark::State& state) {
+    std::size_t count = state.range(0), threads = state.range(1);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto world = std::make_unique<World>();
+        std::vector<ecs::Spawner<ecs::ComponentManager<BenchConfig>>*> spawners;
+        for (std::size_t t = 0; t < threads; t++) spawners.push_back(&world->spawner());
+        state.ResumeTiming();
+        std::vector<std::thread> workers;
+        for (std::size_t t = 0; t < threads; t++) {
+            workers.emplace_back([&, t] {
+                for (std::size_t i = t; i < count; i += threads) {
+                    spawners[t]->createEntity<Position, Velocity, Acceleration, Mass>(
+                        makePosition(i), makeVelocity(i), Acceleration{0.0f, -1.0f}, Mass{1.0f});
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        world->sync();
+        state.PauseTiming();
+        world.reset();
+        state.ResumeTiming();
+    }
+    setEntitiesProcessed(state, count);
+}
+
+void spawnArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"entities", "threads"});
+    b->ArgsProduct({{100'000, 1'000'000}, {1, 2, 4, 8}});
+    b->Unit(benchmark::kMicrosecond);
+    b->UseRealTime();
+}
+
+// One tick of a world split into horizontal bands, one shard per band: every shard moves its
+// entities (wrapping around at y = 1000), then the entities that left their band migrate.
+// With one shard this is a plain world plus the migration scan.
+void BM_ShardedTick(benchmark::State& state) {
+    std::size_t count = state.range(0), shards = state.range(1);
+    constexpr float height = 1000.0f;
+    auto shardOf = [shards](const Position& pos) {
+        return std::min(static_cast<std::size_t>(pos.y * shards / height), shards - 1);
+    };
+    ShardedWorld world(shards);
+    for (std::size_t i = 0; i < count; i++) {
+        Position pos{makePosition(i).x, float(i % 1000)};
+        world.createEntity<Position, Velocity>(shardOf(pos), Position{pos}, makeVelocity(i));
+    }
+    std::size_t migrated = 0;
+    for (auto _ : state) {
+        world.forEach<Position, const Velocity>([=](Position& pos, const Velocity& vel) {
+            pos.x += vel.dx;
+            pos.y += vel.dy;
+            if (pos.y < 0.0f) pos.y += height;
+            if (pos.y >= height) pos.y -= height;
+        });
+        migrated += world.migrate<Position>(shardOf);
+    }
+    state.counters["migrated/tick"] =
+        benchmark::Counter(double(migrated) / double(state.iterations()));
+    setEntitiesProcessed(state, count);
+}
+
+void shardArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"entities", "shards"});
+    b->ArgsProduct({{1'000'000}, {1, 2, 4, 8}});
+    b->Unit(benchmark::kMicrosecond);
+    b->UseRealTime();
+}
+
+// BM_ForEach2 through the query view and std::for_each with the parallel unsequenced policy,
+// the standard library splits the rows over its worker threads.
+void BM_ViewParallel(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    World world;
+    populate(world, count, fragmentation);
+    for (auto _ : state) {
+        auto view = world.view<Position, const Velocity>();
+        std::for_each(std::execution::par_unseq, view.begin(), view.end(), [](auto row) {
+            auto [pos, vel] = row;
+            pos.x += vel.dx;
+            pos.y += vel.dy;
+        });
+    }
+    setEntitiesProcessed(state, count);
+}
+
+// BM_ViewParallel split at chunk boundaries: the algorithm gets the segments of the view and
+// every segment runs a plain loop.
+void BM_ViewSegments(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    World world;
+    populate(world, count, fragmentation);
+    for (auto _ : state) {
+        auto view = world.view<Position, const Velocity>();
+        auto segments = view.segments();
+        std::for_each(std::execution::par, segments.begin(), segments.end(),
+                      [](const auto& segment) {
+                          for (auto [pos, vel] : segment) {
+                              pos.x += vel.dx;
+                              pos.y += vel.dy;
+                          }
+                      });
+    }
+    setEntitiesProcessed(state, count);
+}
+
+// BM_ForEach2 with Velocity registered at runtime, as a script would define it: the typed
+// Position column plus one type-erased byte column per archetype.
+void BM_ForEachDynamic(benchmark::State& state) {
+    std::size_t count = state.range(0), fragmentation = state.range(1);
+    World world;
+    auto velocity = world.registerComponent(ecs::ComponentInfo::of<Velocity>("Velocity"));
+    for (std::size_t i = 0; i < count; i++) {
+        withTag(i % fragmentation, [&]<std::size_t N>() {
+            ecs::EntityId id = world.createEntity<Position, Tag<N>>(makePosition(i), Tag<N>{});
+            Velocity vel = makeVelocity(i);
+            world.addComponent(id, velocity, &vel);
+        });
+    }
+    std::vector<ecs::DynamicComponent> query{velocity};
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        world.forEach<Position>(query, [](Position& pos, ecs::DynamicRow row) {
+            const Velocity& vel = row.get<Velocity>(0);
+            pos.x += vel.dx;
+            pos.y += vel.dy;
+        });
+    }
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+// BM_ForEach2 as a coroutine system that walks the world in slices of one chunk, checking its
+// time budget after every slice. The budget never runs out, so this is the cost of the cursor and
+// the budget checks compared to a single forEach.
+void BM_CoroutineTick(benchmark::State& state) {
+    std::size_t count = state.range(0);
+    World world;
+    populate(world, count, state.range(1));
+    ecs::Scheduler scheduler;
+    auto movement = [](ecs::Scheduler& scheduler, World& world) -> ecs::Task {
+        constexpr std::size_t slice = 1024;
+        for (;;) {
+            std::size_t total = world.count<Position, const Velocity>();
+            for (std::size_t cursor = 0; cursor < total; cursor += slice) {
+                world.forEachInRange<Position, const Velocity>(
+                    cursor, cursor + slice, [](Position& pos, const Velocity& vel) {
+                        pos.x += vel.dx;
+                        pos.y += vel.dy;
+                    });
+                co_await scheduler.budget(std::chrono::hours(1));
+            }
+            co_await scheduler.nextTick();
+        }
+    };
+    scheduler.spawn(movement(scheduler, world));
+    HardwareCounters counters(state);
+    for (auto _ : state) scheduler.tick();
+    counters.stop(count);
+    setEntitiesProcessed(state, count);
+}
+
+// Transparent huge pages the process has resident, in MiB. 0 where /proc is not available.
+double residentHugePagesMiB() {
+    std::ifstream in("/proc/self/smaps_rollup");
+    std::string key;
+    double kib = 0;
+    while (in >> key) {
+        if (key == "AnonHugePages:") {
+            in >> kib;
+            break;
+        }
+    }
+    return kib / 1024;
+}
+
+// Creates the world of the chunk memory benchmarks with its chunks from operator new (memory 0)
+// or huge page slabs (memory 1), see src/v5/memory.hpp.
+std::unique_ptr<World> populateWithChunkMemory(benchmark::State& state) {
+    ecs::setChunkMemory(state.range(1) ? ecs::ChunkMemory::hugePages : ecs::ChunkMemory::heap);
+    auto world = std::make_unique<World>();
+    populate(*world, state.range(0), 1);
+    ecs::setChunkMemory(ecs::ChunkMemory::heap);
+    state.counters["thp_MB"] = residentHugePagesMiB();
+    return world;
+}
+
+// BM_ForEach2 with the chunk memory as second argument.
+void BM_ForEachChunkMemory(benchmark::State& state) {
+    auto world = populateWithChunkMemory(state);
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        world->forEach<Position, const Velocity>([](Position& pos, const Velocity& vel) {
+            pos.x += vel.dx;
+            pos.y += vel.dy;
+        });
+    }
+    counters.stop(state.range(0));
+    setEntitiesProcessed(state, state.range(0));
+}
+
+// BM_ApplyRandom with the chunk memory as second argument. Random rows touch a different page
+// per access, so this is where huge pages save TLB misses.
+void BM_ApplyRandomChunkMemory(benchmark::State& state) {
+    auto world = populateWithChunkMemory(state);
+    auto ids = shuffledIds<ecs::EntityId>(state.range(0));
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        for (ecs::EntityId id : ids) {
+            world->apply<Position, const Velocity>(
+                id, [](Position& pos, const Velocity& vel) { pos.x += vel.dx; });
+        }
+    }
+    counters.stop(state.range(0));
+    setEntitiesProcessed(state, state.range(0));
+}
+
+void chunkMemoryArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"entities", "hugePages"});
+    b->ArgsProduct({{1'000'000, 10'000'000}, {0, 1}});
+    b->Unit(benchmark::kMicrosecond);
+}
+
+// A status effect that comes and goes, stored in archetype columns or in a sparse set.
+struct Burning {
+    float damage;
+};
+
+template <bool Sparse>
+struct StatusConfig {
+    using ComponentList = std::tuple<Position, Velocity, Acceleration, Mass, Burning>;
+};
+
+template <>
+struct StatusConfig<true> {
+    using ComponentList = std::tuple<Position, Velocity, Acceleration, Mass, Burning>;
+    using SparseComponents = std::tuple<Burning>;
+};
+
+// Every tick a different 1/16 of the entities starts burning, the burning entities take damage
+// and stop burning again. In columns every toggle moves the whole row to another archetype and
+// back, in a sparse set only the Burning value is inserted and erased.
+template <bool Sparse>
+void toggleStatus(benchmark::State& state) {
+    using StatusWorld = ecs::World<ecs::ComponentManager<StatusConfig<Sparse>>>;
+    constexpr std::size_t period = 16;
+    std::size_t count = state.range(0);
+    StatusWorld world;
+    for (std::size_t i = 0; i < count; i++) {
+        world.template createEntity<Position, Velocity, Acceleration, Mass>(
+            makePosition(i), makeVelocity(i), Acceleration{0.0f, -1.0f}, Mass{1.0f});
+    }
+    std::size_t tick = 0;
+    HardwareCounters counters(state);
+    for (auto _ : state) {
+        for (std::size_t i = tick % period; i < count; i += period) {
+            world.template addComponent<Position, Velocity, Acceleration, Mass, Burning>(
+                i, Burning{1.0f});
+        }
+        world.template forEach<Mass, const Burning>(
+            [](Mass& mass, const Burning& burning) { mass.m -= 0.001f * burning.damage; });
+        for (std::size_t i = tick % period; i < count; i += period) {
+            world.template removeComponent<Burning>(i);
+        }
+        ++tick;
+    }
+    counters.stop(count / period);
+    setEntitiesProcessed(state, count / period);
+}
+
+void BM_ToggleStatusTable(benchmark::State& state) { toggleStatus<false>(state); }
+void BM_ToggleStatusSparse(benchmark::State& state) { toggleStatus<true>(state); }
+
+void statusArgs(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"entities"});
+    b->Arg(10'000)->Arg(100'000)->Arg(1'000'000);
+    b->Unit(benchmark::kMicrosecond);
+}
+
+}  // namespace
+
+BENCHMARK(BM_Create)->Apply(entityArgs);
+BENCHMARK(BM_Destroy)->Apply(entityArgs);
+BENCHMARK(BM_AddComponent)->Apply(entityArgs);
+BENCHMARK(BM_AddComponentToAll)->Apply(entityArgs);
+BENCHMARK(BM_RemoveComponentFromAll)->Apply(entityArgs);
+BENCHMARK(BM_RemoveComponent)->Apply(entityArgs);
+BENCHMARK(BM_CreateObserved)->Apply(entityArgs);
+BENCHMARK(BM_ApplyRandom)->Apply(entityArgs);
+BENCHMARK(BM_RefRandom)->Apply(entityArgs);
+BENCHMARK(BM_ApplyBatchRandom)->Apply(batchArgs);
+BENCHMARK(BM_Clone)->Apply(cloneArgs);
+BENCHMARK(BM_ForEach1)->Apply(entityArgs);
+BENCHMARK(BM_ForEach2)->Apply(entityArgs);
+BENCHMARK(BM_ReferenceLoop)->Apply(referenceArgs);
+BENCHMARK(BM_ForEach4)->Apply(entityArgs);
+BENCHMARK(BM_SeparatePasses)->Apply(entityArgs);
+BENCHMARK(BM_FusedPasses)->Apply(entityArgs);
+BENCHMARK(BM_ViewParallel)->Apply(entityArgs)->UseRealTime();
+BENCHMARK(BM_ViewSegments)->Apply(entityArgs)->UseRealTime();
+BENCHMARK(BM_ForEachDynamic)->Apply(entityArgs);
+BENCHMARK(BM_CoroutineTick)->Apply(entityArgs);
+BENCHMARK(BM_ShardedTick)->Apply(shardArgs);
+BENCHMARK(BM_SpawnThreads)->Apply(spawnArgs);
+BENCHMARK(BM_ToggleStatusTable)->Apply(statusArgs);
+BENCHMARK(BM_ToggleStatusSparse)->Apply(statusArgs);
+BENCHMARK(BM_ForEachChunkMemory)->Apply(chunkMemoryArgs);
+BENCHMARK(BM_ApplyRandomChunkMemory)->Apply(chunkMemoryArgs);
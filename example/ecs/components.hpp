@@ -0,0 +1,32 @@
+#pragma once
+#include <tuple>
+
+#include "../../src/v5/ecs.hpp"
+
+// Components of the ecs example, shared by the GUI and the headless render extraction.
+
+struct Position {
+    float x, y;
+};
+
+struct Circle {
+    float radius;
+};
+
+struct Color {
+    unsigned char r, g, b, a;
+};
+
+struct Rectangle {
+    float width, length;
+};
+
+struct Velocity {
+    float dx, dy;
+};
+
+struct MyECSConfig {
+    using ComponentList = std::tuple<Position, Circle, Color, Rectangle, Velocity>;
+};
+
+using MyECS = ecs::ComponentManager<MyECSConfig>;
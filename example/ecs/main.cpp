@@ -4,37 +4,15 @@
 #include <imgui_impl_opengl3.h>
 
 #include <chrono>
+#include <exception>
 #include <iostream>
 #include <random>
 #include <string>
 #include <type_traits>
 
-#include "../../src/v5/ecs.hpp"
-struct Position {
-    float x, y;
-};
-
-struct Circle {
-    float radius;
-};
-
-struct Color {
-    unsigned char r, g, b, a;
-};
-
-struct Rectangle {
-    float width, length;
-};
-
-struct Velocity {
-    float dx, dy;
-};
-
-struct MyECSConfig {
-    using ComponentList = std::tuple<Position, Circle, Color, Rectangle, Velocity>;
-};
-
-using MyECS = ecs::ComponentManager<MyECSConfig>;
+#include "components.hpp"
+#include "render.hpp"
+#include "simulation.hpp"
 
 template <typename CM, std::size_t I>
 void ShowComponentEntry(ecs::EntityId id) {
@@ -122,6 +100,10 @@ int main() {
     float deltaTime = 0.0f;
 
     ecs::World<MyECS> world;
+    RenderExtraction extraction;
+    RenderSnapshotBuffer snapshots;
+    // Runs the ticks, started once instead of a thread per frame
+    ecs::detail::Worker simulation;
 
     world.createEntity<Position, Circle, Color>(Position{100.0f, 100.0f}, Circle{10.0f},
                                                 Color{255, 0, 0, 255});
@@ -162,33 +144,39 @@ int main() {
         int display_w, display_h;
         glfwGetFramebufferSize(window, &display_w, &display_h);
 
-        auto t0 = std::chrono::steady_clock::now();
-        // update movement
-        world.forEach<Position, Velocity>([&](Position& pos, Velocity& vel) {
-            pos.x += vel.dx * deltaTime;
-            pos.y += vel.dy * deltaTime;
+        ECS_PROFILE_SCOPE("frame");
+        // The next tick runs on a worker while this thread draws the snapshot of the last one, so
+        // a frame takes max(movement, draw) instead of their sum. The world is only touched
+        // again after the tick finished.
+        long movementTime = 0;
+        simulation.post([&world, &movementTime, deltaTime, display_w, display_h] {
+            auto t0 = std::chrono::steady_clock::now();
+            moveEntities(world, deltaTime, display_w, display_h);
+            movementTime = std::chrono::duration_cast<std::chrono::microseconds>(
+                               std::chrono::steady_clock::now() - t0)
+                               .count();
+        });
 
-            // borders
-            if (pos.x < 0) {
-                pos.x = 0;
-                vel.dx = -vel.dx;
-            }
-            if (pos.x > display_w) {
-                pos.x = display_w;
-                vel.dx = -vel.dx;
-            }
-            if (pos.y < 0) {
-                pos.y = 0;
-                vel.dy = -vel.dy;
-            }
-            if (pos.y > display_h) {
-                pos.y = display_h;
-                vel.dy = -vel.dy;
+        {
+            ECS_PROFILE_SCOPE("draw");
+            // pack all shapes into one instance buffer, then submit it in one pass
+            extraction.extract(snapshots.acquire());
+            ImDrawList* drawList = ImGui::GetBackgroundDrawList();
+            for (const Instance& instance : extraction.instances()) {
+                if (instance.shape == Shape::Circle) {
+                    drawList->AddCircleFilled(ImVec2(instance.x, instance.y), instance.sizeX,
+                                              instance.color, 10);
+                } else {
+                    drawList->AddRectFilled(
+                        ImVec2(instance.x, instance.y),
+                        ImVec2(instance.x + instance.sizeX, instance.y + instance.sizeY),
+                        instance.color);
+                }
             }
-        });
+        }
 
-        auto t1 = std::chrono::steady_clock::now();
-        auto movementTime = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+        if (auto error = simulation.wait()) std::rethrow_exception(error);
+        snapshots.publish(world);
 
         // Beispiel-GUI
         ImGui::Begin("Demo");
@@ -196,22 +184,9 @@ int main() {
                     1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
         ImGui::Text("Movement average %lo µs/frame", movementTime, ImGui::GetIO().Framerate);
         ImGui::Text("entities: %i", world.getEntityCount());
+        ImGui::Text("ecs memory: %zu KiB", world.stats().bytesTotal() / 1024);
         ImGui::End();
 
-        // draw circles
-        world.forEach<Position, Circle, Color>([](Position& pos, Circle& circle, Color& color) {
-            ImGui::GetBackgroundDrawList()->AddCircleFilled(
-                ImVec2(pos.x, pos.y), circle.radius, IM_COL32(color.r, color.g, color.b, color.a),
-                10);
-        });
-
-        // draw rectangle
-        world.forEach<Position, Rectangle, Color>([](Position& pos, Rectangle& rect, Color& color) {
-            ImGui::GetBackgroundDrawList()->AddRectFilled(
-                ImVec2(pos.x, pos.y), ImVec2(pos.x + rect.length, pos.y + rect.width),
-                IM_COL32(color.r, color.g, color.b, color.a));
-        });
-
         // ImGui::Begin("Entities");
         // world.forEachEntity([&](ecs::EntityId id, ecs::detail::EntityLocation location) {
         //     // create tree node for entity
@@ -234,6 +209,11 @@ int main() {
         glfwSwapBuffers(window);
     }
 
+#ifdef ECS_PROFILING
+    // open in chrome://tracing or ui.perfetto.dev
+    ecs::profiler::Profiler::instance().writeChromeTrace("ecs_trace.json");
+#endif
+
     // Cleanup
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
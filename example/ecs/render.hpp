@@ -0,0 +1,148 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../../src/v5/worker.hpp"
+#include "components.hpp"
+
+// Render extraction: copies the draw data of all shapes out of the world into one contiguous
+// instance buffer, which the renderer submits with a single instanced draw instead of one call
+// per entity. It needs no graphics context, so it runs and is benchmarked headless
+// (bench/render.cpp).
+
+enum class Shape : uint32_t { Circle, Rectangle };
+
+// Per-instance attributes of one shape.
+// Circles: (x, y) is the center, sizeX = sizeY = radius.
+// Rectangles: (x, y) is the top left corner, sizeX = length, sizeY = width.
+struct Instance {
+    float x, y;
+    float sizeX, sizeY;
+    uint32_t color;
+    Shape shape;
+};
+
+// Packs a color into RGBA8 with r in the lowest byte, the layout of IM_COL32.
+inline uint32_t packColor(const Color& color) {
+    return uint32_t(color.r) | uint32_t(color.g) << 8 | uint32_t(color.b) << 16 |
+           uint32_t(color.a) << 24;
+}
+
+// The columns the renderer reads, published by the simulation for a render thread.
+using RenderSnapshot = ecs::Snapshot<MyECS, Position, Circle, Rectangle, Color>;
+using RenderSnapshotBuffer = ecs::SnapshotBuffer<MyECS, Position, Circle, Rectangle, Color>;
+
+// Owns the instance buffer, its capacity is kept from frame to frame, and the worker threads of
+// extract, started on first use and kept as well.
+class RenderExtraction {
+   public:
+    // Below this many instances per task another thread costs more than it saves.
+    static constexpr size_t minInstancesPerTask = 32 * 1024;
+
+    // Rebuilds the buffer from the world or a RenderSnapshot, circles first, then rectangles. The
+    // instance range is split evenly into up to maxThreads tasks, each runs both queries on its
+    // part. The queries only read and the tasks write disjoint parts of the buffer. The first
+    // task runs on the calling thread, the others on the workers.
+    template <typename Source>
+    void extract(Source& world,
+                 size_t maxThreads = std::max(1u, std::thread::hardware_concurrency())) {
+        ECS_PROFILE_SCOPE("RenderExtraction::extract");
+        prepare(world);
+        size_t total = buffer.size();
+
+        size_t tasks = std::clamp(total / minInstancesPerTask, size_t(1), maxThreads);
+        while (workers.size() + 1 < tasks) {
+            workers.push_back(std::make_unique<ecs::detail::Worker>());
+        }
+        for (size_t t = 1; t < tasks; ++t) {
+            workers[t - 1]->post([&world, this, t, tasks, total] {
+                extractRange(world, total * t / tasks, total * (t + 1) / tasks);
+            });
+        }
+        std::exception_ptr failure;
+        try {
+            extractRange(world, 0, total / tasks);
+        } catch (...) {
+            failure = std::current_exception();
+        }
+        // wait for all tasks before rethrowing, they write into the buffer
+        for (size_t t = 1; t < tasks; ++t) {
+            std::exception_ptr error = workers[t - 1]->wait();
+            if (error && !failure) failure = error;
+        }
+        if (failure) std::rethrow_exception(failure);
+    }
+
+    // Sizes the buffer for the world, to fill it with the systems below instead of extract.
+    template <typename Source>
+    void prepare(Source& world) {
+        circleCount = world.template count<Position, Circle, Color>();
+        buffer.resize(circleCount + world.template count<Position, Rectangle, Color>());
+    }
+
+    // The circle and the rectangle system filling the buffer sized by prepare. They run in one
+    // World::forEachFused pass with other systems, e.g. the movement, so Position is read once.
+    auto systems() {
+        Instance* circleOut = buffer.data();
+        Instance* rectangleOut = buffer.data() + circleCount;
+        return std::make_pair(
+            ecs::makeSystem<const Position, const Circle, const Color>(
+                [circleOut](const Position& pos, const Circle& circle, const Color& color) mutable {
+                    *circleOut++ = circleInstance(pos, circle, color);
+                }),
+            ecs::makeSystem<const Position, const Rectangle, const Color>(
+                [rectangleOut](const Position& pos, const Rectangle& rect,
+                               const Color& color) mutable {
+                    *rectangleOut++ = rectangleInstance(pos, rect, color);
+                }));
+    }
+
+    // All instances of the last extract, circles in [0, circles()), then the rectangles.
+    const std::vector<Instance>& instances() const { return buffer; }
+    size_t circles() const { return circleCount; }
+
+   private:
+    std::vector<Instance> buffer;
+    size_t circleCount = 0;
+    std::vector<std::unique_ptr<ecs::detail::Worker>> workers;
+
+    static Instance circleInstance(const Position& pos, const Circle& circle, const Color& color) {
+        return Instance{pos.x,         pos.y,           circle.radius,
+                        circle.radius, packColor(color), Shape::Circle};
+    }
+
+    static Instance rectangleInstance(const Position& pos, const Rectangle& rect,
+                                      const Color& color) {
+        return Instance{pos.x,      pos.y,           rect.length,
+                        rect.width, packColor(color), Shape::Rectangle};
+    }
+
+    // Fills buffer[first, last).
+    template <typename Source>
+    void extractRange(Source& world, size_t first, size_t last) {
+        ECS_PROFILE_SCOPE("RenderExtraction::extractRange");
+        if (first < circleCount) {
+            Instance* out = buffer.data() + first;
+            world.template forEachInRange<const Position, const Circle, const Color>(
+                first, std::min(last, circleCount),
+                [&](const Position& pos, const Circle& circle, const Color& color) {
+                    *out++ = circleInstance(pos, circle, color);
+                });
+        }
+        if (last > circleCount) {
+            size_t begin = std::max(first, circleCount);
+            Instance* out = buffer.data() + begin;
+            world.template forEachInRange<const Position, const Rectangle, const Color>(
+                begin - circleCount, last - circleCount,
+                [&](const Position& pos, const Rectangle& rect, const Color& color) {
+                    *out++ = rectangleInstance(pos, rect, color);
+                });
+        }
+    }
+};
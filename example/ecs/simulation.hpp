@@ -0,0 +1,37 @@
+#pragma once
+#include "components.hpp"
+
+// Simulation step of the ecs example, shared by the GUI and the headless harness.
+
+// Returns the movement system: moves an entity and bounces it off the borders of a
+// display_w x display_h area.
+inline auto movement(float dt, int display_w, int display_h) {
+    return ecs::makeSystem<Position, Velocity>([=](Position& pos, Velocity& vel) {
+        pos.x += vel.dx * dt;
+        pos.y += vel.dy * dt;
+
+        // borders
+        if (pos.x < 0) {
+            pos.x = 0;
+            vel.dx = -vel.dx;
+        }
+        if (pos.x > display_w) {
+            pos.x = display_w;
+            vel.dx = -vel.dx;
+        }
+        if (pos.y < 0) {
+            pos.y = 0;
+            vel.dy = -vel.dy;
+        }
+        if (pos.y > display_h) {
+            pos.y = display_h;
+            vel.dy = -vel.dy;
+        }
+    });
+}
+
+// Moves all entities with a Velocity.
+inline void moveEntities(ecs::World<MyECS>& world, float dt, int display_w, int display_h) {
+    ECS_PROFILE_SCOPE("movement");
+    world.forEach<Position, Velocity>(movement(dt, display_w, display_h).func);
+}
@@ -0,0 +1,280 @@
+// Runs the simulation of the ecs and the oop example without a window, e.g. on build machines.
+// Both versions get the same seeded workload and a fixed time step, their final states must be
+// identical for the timings to be comparable.
+//
+// Usage: EntityComponentSystem_headless [--entities N] [--ticks N] [--seed N] [--dt SECONDS]
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../ecs/components.hpp"
+#include "../ecs/render.hpp"
+#include "../ecs/simulation.hpp"
+#include "../oop/entities.hpp"
+
+namespace {
+
+struct Options {
+    size_t entities = 100000;
+    size_t ticks = 1000;
+    unsigned seed = 42;
+    float dt = 1.0f / 60.0f;
+    // display size of the GUI examples, the entities bounce off its borders
+    int width = 1280;
+    int height = 720;
+};
+
+// One entity of the workload, created in both versions.
+struct Spawn {
+    float x, y, dx, dy;
+    unsigned char r, g, b;
+    bool rectangle;
+};
+
+// Bouncing circles like the examples, every 10th entity is a rectangle.
+std::vector<Spawn> makeWorkload(const Options& options) {
+    std::mt19937 rng(options.seed);
+    std::uniform_real_distribution<float> x(0.0f, float(options.width));
+    std::uniform_real_distribution<float> y(0.0f, float(options.height));
+    std::uniform_real_distribution<float> velocity(-100.0f, 100.0f);
+    std::uniform_int_distribution<int> channel(0, 255);
+    std::vector<Spawn> workload(options.entities);
+    for (size_t i = 0; i < workload.size(); i++) {
+        workload[i] = Spawn{x(rng),
+                            y(rng),
+                            velocity(rng),
+                            velocity(rng),
+                            static_cast<unsigned char>(channel(rng)),
+                            static_cast<unsigned char>(channel(rng)),
+                            static_cast<unsigned char>(channel(rng)),
+                            i % 10 == 0};
+    }
+    return workload;
+}
+
+struct State {
+    float x, y, dx, dy;
+};
+
+// Time spent in each phase of one version.
+struct Timings {
+    double setup = 0, move = 0, draw = 0;  // ms
+};
+
+double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+// How the ecs version schedules movement and render extraction.
+enum class Mode {
+    // One after the other.
+    Sequential,
+    // One World::forEachFused pass, its time is reported as move.
+    Fused,
+    // Movement on a worker while this thread extracts the snapshot of the previous tick, the
+    // frame time is reported as move.
+    Pipelined,
+};
+
+std::vector<State> runEcs(const Options& options, const std::vector<Spawn>& workload,
+                          Timings& timings, Mode mode) {
+    auto t0 = std::chrono::steady_clock::now();
+    ecs::World<MyECS> world;
+    std::vector<ecs::EntityId> ids;
+    ids.reserve(workload.size());
+    for (const Spawn& spawn : workload) {
+        Color color{spawn.r, spawn.g, spawn.b, 255};
+        if (spawn.rectangle) {
+            ids.push_back(world.createEntity<Position, Rectangle, Color, Velocity>(
+                Position{spawn.x, spawn.y}, Rectangle{10.0f, 20.0f}, Color{color},
+                Velocity{spawn.dx, spawn.dy}));
+        } else {
+            ids.push_back(world.createEntity<Position, Circle, Color, Velocity>(
+                Position{spawn.x, spawn.y}, Circle{10.0f}, Color{color},
+                Velocity{spawn.dx, spawn.dy}));
+        }
+    }
+    timings.setup = msSince(t0);
+
+    RenderExtraction extraction;
+    RenderSnapshotBuffer snapshots;
+    // Moves the entities in Mode::Pipelined, started once instead of a thread per tick
+    std::unique_ptr<ecs::detail::Worker> simulation;
+    if (mode == Mode::Pipelined) simulation = std::make_unique<ecs::detail::Worker>();
+    for (size_t tick = 0; tick < options.ticks; tick++) {
+        auto t1 = std::chrono::steady_clock::now();
+        if (mode == Mode::Pipelined) {
+            simulation->post(
+                [&] { moveEntities(world, options.dt, options.width, options.height); });
+            extraction.extract(snapshots.acquire());
+            if (auto error = simulation->wait()) std::rethrow_exception(error);
+            snapshots.publish(world);
+            timings.move += msSince(t1);
+            continue;
+        }
+        if (mode == Mode::Fused) {
+            extraction.prepare(world);
+            auto [circles, rectangles] = extraction.systems();
+            world.forEachFused(movement(options.dt, options.width, options.height), circles,
+                               rectangles);
+            timings.move += msSince(t1);
+            continue;
+        }
+        moveEntities(world, options.dt, options.width, options.height);
+        auto t2 = std::chrono::steady_clock::now();
+        extraction.extract(world);
+        timings.draw += msSince(t2);
+        timings.move += std::chrono::duration<double, std::milli>(t2 - t1).count();
+    }
+
+    std::vector<State> state;
+    state.reserve(ids.size());
+    for (ecs::EntityId id : ids) {
+        world.apply<const Position, const Velocity>(
+            id, [&](const Position& pos, const Velocity& vel) {
+                state.push_back(State{pos.x, pos.y, vel.dx, vel.dy});
+            });
+    }
+    return state;
+}
+
+// Collects the drawn shapes as instances, the work of the ecs render extraction.
+class InstanceCanvas : public oop::Canvas {
+   public:
+    std::vector<Instance> instances;
+
+    void circle(oop::Position center, float radius, oop::Color color) override {
+        instances.push_back(Instance{center.x, center.y, radius, radius,
+                                     packColor(Color{color.r, color.g, color.b, color.a}),
+                                     Shape::Circle});
+    }
+
+    void rectangle(oop::Position topLeft, float width, float length, oop::Color color) override {
+        instances.push_back(Instance{topLeft.x, topLeft.y, length, width,
+                                     packColor(Color{color.r, color.g, color.b, color.a}),
+                                     Shape::Rectangle});
+    }
+};
+
+std::vector<State> runOop(const Options& options, const std::vector<Spawn>& workload,
+                          Timings& timings) {
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<oop::Entity>> world;
+    world.reserve(workload.size());
+    for (const Spawn& spawn : workload) {
+        oop::Position pos{spawn.x, spawn.y};
+        oop::Velocity vel{spawn.dx, spawn.dy};
+        oop::Color color{spawn.r, spawn.g, spawn.b, 255};
+        if (spawn.rectangle) {
+            world.push_back(std::make_unique<oop::RectangleEntity>(pos, vel, color, 10.0f, 20.0f));
+        } else {
+            world.push_back(std::make_unique<oop::CircleEntity>(pos, vel, color, 10.0f));
+        }
+    }
+    timings.setup = msSince(t0);
+
+    InstanceCanvas canvas;
+    for (size_t tick = 0; tick < options.ticks; tick++) {
+        auto t1 = std::chrono::steady_clock::now();
+        for (auto& entity : world) entity->move(options.dt, options.width, options.height);
+        auto t2 = std::chrono::steady_clock::now();
+        canvas.instances.clear();
+        for (const auto& entity : world) entity->draw(canvas);
+        timings.draw += msSince(t2);
+        timings.move += std::chrono::duration<double, std::milli>(t2 - t1).count();
+    }
+
+    std::vector<State> state;
+    state.reserve(world.size());
+    for (const auto& entity : world) {
+        const oop::Position& pos = entity->getPosition();
+        const oop::Velocity& vel = entity->getVelocity();
+        state.push_back(State{pos.x, pos.y, vel.dx, vel.dy});
+    }
+    return state;
+}
+
+void report(const char* name, const Timings& timings, size_t ticks) {
+    std::cout << name << ": setup " << timings.setup << " ms, move " << timings.move << " ms ("
+              << timings.move * 1000.0 / ticks << " us/tick), draw " << timings.draw << " ms ("
+              << timings.draw * 1000.0 / ticks << " us/tick)\n";
+}
+
+// Number of entities whose state differs, prints the first one.
+size_t compare(const char* name, const std::vector<State>& ecs, const std::vector<State>& oop) {
+    size_t mismatches = 0;
+    for (size_t i = 0; i < ecs.size(); i++) {
+        const State& a = ecs[i];
+        const State& b = oop[i];
+        if (a.x == b.x && a.y == b.y && a.dx == b.dx && a.dy == b.dy) continue;
+        if (mismatches++ == 0) {
+            std::cerr << name << " entity " << i << " differs: ecs (" << a.x << ", " << a.y
+                      << ", " << a.dx << ", " << a.dy << "), oop (" << b.x << ", " << b.y << ", "
+                      << b.dx << ", " << b.dy << ")\n";
+        }
+    }
+    if (mismatches > 0) {
+        std::cerr << name << ": " << mismatches << " of " << ecs.size() << " entities differ\n";
+    }
+    return mismatches;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--entities") == 0) {
+            options.entities = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--ticks") == 0) {
+            options.ticks = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            options.seed = static_cast<unsigned>(std::strtoul(argv[i + 1], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--dt") == 0) {
+            options.dt = std::strtof(argv[i + 1], nullptr);
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && options.ticks > 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "usage: " << argv[0]
+                  << " [--entities N] [--ticks N] [--seed N] [--dt SECONDS]\n";
+        return 2;
+    }
+    std::cout << options.entities << " entities, " << options.ticks << " ticks, dt "
+              << options.dt << ", seed " << options.seed << '\n';
+
+    std::vector<Spawn> workload = makeWorkload(options);
+    Timings ecsTimings, fusedTimings, pipelinedTimings, oopTimings;
+    std::vector<State> ecsState = runEcs(options, workload, ecsTimings, Mode::Sequential);
+    std::vector<State> fusedState = runEcs(options, workload, fusedTimings, Mode::Fused);
+    std::vector<State> pipelinedState =
+        runEcs(options, workload, pipelinedTimings, Mode::Pipelined);
+    std::vector<State> oopState = runOop(options, workload, oopTimings);
+    report("ecs", ecsTimings, options.ticks);
+    report("ecs fused (move = move + draw)", fusedTimings, options.ticks);
+    report("ecs pipelined (move = frame)", pipelinedTimings, options.ticks);
+    report("oop", oopTimings, options.ticks);
+
+    // all versions run the same float operations in the same order, so the results match
+    // bit for bit
+    if (compare("ecs", ecsState, oopState) + compare("ecs fused", fusedState, oopState) +
+            compare("ecs pipelined", pipelinedState, oopState) >
+        0) {
+        return 1;
+    }
+    std::cout << "final state identical\n";
+    return 0;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// Entities of the oop example: one virtual class per shape, each object owns all its data.
+// Shared by the GUI and the headless harness, drawing goes through Canvas.
+namespace oop {
+
+struct Position {
+    float x, y;
+};
+
+struct Color {
+    unsigned char r, g, b, a;
+};
+
+struct Velocity {
+    float dx, dy;
+};
+
+// Receives the shapes drawn by Entity::draw.
+class Canvas {
+   public:
+    virtual ~Canvas() = default;
+    virtual void circle(Position center, float radius, Color color) = 0;
+    virtual void rectangle(Position topLeft, float width, float length, Color color) = 0;
+};
+
+class Entity {
+   protected:
+    Position position;
+    Velocity velocity;
+    Color color;
+
+   public:
+    Entity(Position pos, Velocity vel, Color col) : position(pos), velocity(vel), color(col) {}
+
+    virtual ~Entity() = default;
+
+    virtual void move(float dt, int display_w, int display_h) {
+        position.x += velocity.dx * dt;
+        position.y += velocity.dy * dt;
+
+        // borders
+        if (position.x < 0) {
+            position.x = 0;
+            velocity.dx = -velocity.dx;
+        }
+        if (position.x > display_w) {
+            position.x = display_w;
+            velocity.dx = -velocity.dx;
+        }
+        if (position.y < 0) {
+            position.y = 0;
+            velocity.dy = -velocity.dy;
+        }
+        if (position.y > display_h) {
+            position.y = display_h;
+            velocity.dy = -velocity.dy;
+        }
+    }
+
+    virtual void draw(Canvas& canvas) const = 0;
+
+    const Position& getPosition() const { return position; }
+    const Velocity& getVelocity() const { return velocity; }
+};
+
+class CircleEntity : public Entity {
+   private:
+    float radius;
+
+   public:
+    CircleEntity(Position pos, Velocity vel, Color col, float rad)
+        : Entity(pos, vel, col), radius(rad) {}
+
+    void draw(Canvas& canvas) const override { canvas.circle(position, radius, color); }
+};
+
+class RectangleEntity : public Entity {
+   private:
+    float width, length;
+
+   public:
+    RectangleEntity(Position pos, Velocity vel, Color col, float wid, float len)
+        : Entity(pos, vel, col), width(wid), length(len) {}
+
+    void draw(Canvas& canvas) const override { canvas.rectangle(position, width, length, color); }
+};
+
+}  // namespace oop
@@ -9,84 +9,21 @@
 #include <string>
 #include <type_traits>
 
-struct Position {
-    float x, y;
-};
-
-struct Color {
-    unsigned char r, g, b, a;
-};
-
-struct Velocity {
-    float dx, dy;
-};
-
-class Entity {
-   protected:
-    Position position;
-    Velocity velocity;
-    Color color;
-
-   public:
-    Entity(Position pos, Velocity vel, Color col) : position(pos), velocity(vel), color(col) {}
-
-    virtual ~Entity() = default;
-
-    virtual void move(float dt, int display_w, int display_h) {
-        position.x += velocity.dx * dt;
-        position.y += velocity.dy * dt;
-
-        // borders
-        if (position.x < 0) {
-            position.x = 0;
-            velocity.dx = -velocity.dx;
-        }
-        if (position.x > display_w) {
-            position.x = display_w;
-            velocity.dx = -velocity.dx;
-        }
-        if (position.y < 0) {
-            position.y = 0;
-            velocity.dy = -velocity.dy;
-        }
-        if (position.y > display_h) {
-            position.y = display_h;
-            velocity.dy = -velocity.dy;
-        }
-    }
-
-    virtual void draw() const = 0;
-
-    const Position& getPosition() const { return position; }
-    const Velocity& getVelocity() const { return velocity; }
-};
+#include "entities.hpp"
 
-class CircleEntity : public Entity {
-   private:
-    float radius;
+using namespace oop;
 
+// Draws the entities into the ImGui background draw list.
+class ImGuiCanvas : public Canvas {
    public:
-    CircleEntity(Position pos, Velocity vel, Color col, float rad)
-        : Entity(pos, vel, col), radius(rad) {}
-
-    void draw() const override {
+    void circle(Position center, float radius, Color color) override {
         ImGui::GetBackgroundDrawList()->AddCircleFilled(
-            ImVec2(position.x, position.y), radius, IM_COL32(color.r, color.g, color.b, color.a),
-            10);
+            ImVec2(center.x, center.y), radius, IM_COL32(color.r, color.g, color.b, color.a), 10);
     }
-};
-
-class RectangleEntity : public Entity {
-   private:
-    float width, length;
-
-   public:
-    RectangleEntity(Position pos, Velocity vel, Color col, float wid, float len)
-        : Entity(pos, vel, col), width(wid), length(len) {}
 
-    void draw() const override {
+    void rectangle(Position topLeft, float width, float length, Color color) override {
         ImGui::GetBackgroundDrawList()->AddRectFilled(
-            ImVec2(position.x, position.y), ImVec2(position.x + length, position.y + width),
+            ImVec2(topLeft.x, topLeft.y), ImVec2(topLeft.x + length, topLeft.y + width),
             IM_COL32(color.r, color.g, color.b, color.a));
     }
 };
@@ -144,6 +81,7 @@ int main() {
     float deltaTime = 0.0f;
 
     std::vector<Entity*> world;
+    ImGuiCanvas canvas;
     world.push_back(new RectangleEntity{Position{100.0f, 100.0f}, Velocity{70.0f, -20.0f},
                                         Color{0, 0, 255, 255}, 10.0f, 20.0f});
 
@@ -189,7 +127,7 @@ int main() {
         ImGui::End();
 
         for (auto entity : world) {
-            entity->draw();
+            entity->draw(canvas);
         }
 
         ImGui::Render();
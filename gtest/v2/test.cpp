@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "../../src/v2/ecs.hpp"
+
+// Storages are global per component type, so every test uses types of its own.
+
+namespace {
+
+template <int Tag>
+struct Position {
+    int x, y;
+};
+
+template <int Tag>
+struct Velocity {
+    int dx, dy;
+};
+
+// The entities that have both A and B are the first group.size() of both storages, in the same
+// order.
+template <typename A, typename B>
+void expectPacked(const ecs::Group<A, B>& group) {
+    auto& first = ecs::getStorage<A>().dense;
+    auto& second = ecs::getStorage<B>().dense;
+    size_t both = std::count_if(first.begin(), first.end(), [](int entityId) {
+        return ecs::getStorage<B>().get(entityId) != nullptr;
+    });
+    ASSERT_EQ(both, group.size());
+    for (size_t i = 0; i < group.size(); i++) EXPECT_EQ(first[i], second[i]);
+}
+
+}  // namespace
+
+TEST(V2, testGroupOverExistingEntities) {
+    using Pos = Position<0>;
+    using Vel = Velocity<0>;
+    std::vector<ecs::Entity> entities;
+    for (int i = 0; i < 100; i++) {
+        entities.push_back(ecs::createEntity());
+        ecs::addComponent(entities.back(), Pos{entities.back().id, 0});
+        if (i % 3 == 0) ecs::addComponent(entities.back(), Vel{entities.back().id, 0});
+    }
+
+    ecs::Group<Pos, Vel> group;
+    EXPECT_EQ(34, group.size());
+    expectPacked(group);
+    int visited = 0;
+    group.each([&](Pos& pos, Vel& vel) {
+        EXPECT_EQ(pos.x, vel.dx);
+        visited++;
+    });
+    EXPECT_EQ(34, visited);
+}
+
+TEST(V2, testGroupInterleavedAddRemove) {
+    using Pos = Position<1>;
+    using Vel = Velocity<1>;
+    std::vector<ecs::Entity> entities;
+    for (int i = 0; i < 200; i++) entities.push_back(ecs::createEntity());
+    ecs::Group<Pos, Vel> group;
+
+    // each step adds or removes one component of a random entity, so members and non-members
+    // enter and leave at both ends of the storages
+    std::mt19937 rng(42);
+    for (int step = 0; step < 2000; step++) {
+        ecs::Entity e = entities[rng() % entities.size()];
+        switch (rng() % 6) {
+            case 0:
+            case 1:
+                ecs::addComponent(e, Pos{e.id, 0});
+                break;
+            case 2:
+            case 3:
+                ecs::addComponent(e, Vel{e.id, 0});
+                break;
+            case 4:
+                ecs::getStorage<Pos>().remove(e.id);
+                break;
+            case 5:
+                ecs::getStorage<Vel>().remove(e.id);
+                break;
+        }
+        expectPacked(group);
+    }
+
+    size_t members = 0;
+    for (ecs::Entity e : entities) {
+        if (ecs::hasComponent<Pos>(e) && ecs::hasComponent<Vel>(e)) members++;
+    }
+    EXPECT_GT(members, 0);
+    EXPECT_EQ(members, group.size());
+    group.each([](Pos& pos, Vel& vel) { EXPECT_EQ(pos.x, vel.dx); });
+}
+
+TEST(V2, testGroupOwnsStoragesOnce) {
+    using Pos = Position<2>;
+    using Vel = Velocity<2>;
+    using Other = Velocity<3>;
+    {
+        ecs::Group<Pos, Vel> group;
+        EXPECT_THROW((ecs::Group<Vel, Other>{}), std::logic_error);
+        EXPECT_THROW((ecs::Group<Pos, Vel>{}), std::logic_error);
+    }
+    // the destroyed group released its storages
+    ecs::Group<Vel, Other> group;
+    EXPECT_EQ(0, group.size());
+}
+
+TEST(V2, testSparseIndexLargeIds) {
+    using Pos = Position<4>;
+    auto& storage = ecs::getStorage<Pos>();
+    // far beyond the 1000 ids of the former flat index
+    std::vector<int> ids = {1000, 1001, 4095, 4096, 250000, 1000000, 5000000};
+    for (int id : ids) ecs::addComponent(ecs::Entity{id}, Pos{id, 0});
+    for (int id : ids) {
+        ASSERT_NE(nullptr, ecs::getComponent<Pos>(ecs::Entity{id}));
+        EXPECT_EQ(id, ecs::getComponent<Pos>(ecs::Entity{id})->x);
+    }
+    EXPECT_FALSE(ecs::hasComponent<Pos>(ecs::Entity{999999}));
+    EXPECT_FALSE(ecs::hasComponent<Pos>(ecs::Entity{6000000}));
+    // one page per 4096 ids in use, not one slot per id
+    EXPECT_LT(storage.indexBytes(), size_t{1} << 20);
+
+    storage.remove(1000000);
+    EXPECT_FALSE(ecs::hasComponent<Pos>(ecs::Entity{1000000}));
+    EXPECT_EQ(5000000, ecs::getComponent<Pos>(ecs::Entity{5000000})->x);
+}
+
+TEST(V2, testSparseIndexReleasesPages) {
+    using Pos = Position<5>;
+    auto& storage = ecs::getStorage<Pos>();
+    EXPECT_EQ(0, storage.indexBytes());
+    // grow the page table once, so only pages change below
+    storage.add(3 * 4096 - 1, Pos{});
+    storage.remove(3 * 4096 - 1);
+    size_t empty = storage.indexBytes();
+
+    for (int id = 0; id < 3 * 4096; id++) storage.add(id, Pos{id, 0});
+    size_t full = storage.indexBytes();
+    EXPECT_GT(full, empty);
+
+    // the last member of a page releases it
+    for (int id = 0; id < 4096; id++) storage.remove(id);
+    size_t twoPages = storage.indexBytes();
+    EXPECT_EQ((full - empty) / 3 * 2, twoPages - empty);
+    // a page with a member left stays
+    for (int id = 4096; id < 2 * 4096 - 1; id++) storage.remove(id);
+    EXPECT_EQ(twoPages, storage.indexBytes());
+
+    for (int id = 2 * 4096 - 1; id < 3 * 4096; id++) storage.remove(id);
+    EXPECT_EQ(empty, storage.indexBytes());
+    EXPECT_TRUE(storage.dense.empty());
+}
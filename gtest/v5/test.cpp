@@ -1,6 +1,21 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <execution>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+
 #include "../../src/v5/ecs.hpp"
+#include "../../src/v5/scheduler.hpp"
+#include "../../src/v5/sharded.hpp"
 
 struct Position {
     int x, y;
@@ -234,4 +249,1492 @@ TEST(V5, testRemoveEntity) {
     });
 
     EXPECT_THROW({ world.destroyEntity(e3); }, std::out_of_range);
-}
\ No newline at end of file
+}
+
+TEST(V5, testForeachConst) {
+    ecs::World<MyECS> world;
+    world.createEntity<Position, Velocity>(Position{1, 2}, Velocity{3, 4});
+    world.createEntity<Position, Velocity>(Position{5, 6}, Velocity{7, 8});
+    int sum = 0;
+    world.forEach<const Position, Velocity>([&](const Position& pos, Velocity& vel) {
+        sum += pos.x;
+        vel.dx = pos.y;
+    });
+    EXPECT_EQ(6, sum);
+}
+
+TEST(V5, testForeachManyChunks) {
+    ecs::World<MyECS> world;
+    const int count = static_cast<int>(ecs::detail::chunkCapacity) * 3 + 7;
+    for (int i = 0; i < count; i++) world.createEntity<Position>(Position{i, 0});
+    world.forEach<Position>([](Position& pos) { pos.y = pos.x * 2; });
+    int visited = 0;
+    world.forEach<const Position>([&](const Position& pos) {
+        EXPECT_EQ(pos.x * 2, pos.y);
+        visited++;
+    });
+    EXPECT_EQ(count, visited);
+}
+
+TEST(V5, testClone) {
+    ecs::World<MyECS> world;
+    auto e1 = world.createEntity<Position>(Position{1, 1});
+    auto e2 = world.createEntity<Position, Velocity>(Position{2, 2}, Velocity{3, 3});
+
+    auto fork = world.clone();
+    fork.apply<Position>(e1, [](Position& pos) { pos.x = 100; });
+    world.apply<Position>(e2, [](Position& pos) { pos.x = 200; });
+
+    world.apply<const Position>(e1, [](const Position& pos) { EXPECT_EQ(1, pos.x); });
+    fork.apply<const Position>(e1, [](const Position& pos) { EXPECT_EQ(100, pos.x); });
+    world.apply<const Position>(e2, [](const Position& pos) { EXPECT_EQ(200, pos.x); });
+    fork.apply<const Position>(e2, [](const Position& pos) { EXPECT_EQ(2, pos.x); });
+}
+
+TEST(V5, testCloneStructuralChanges) {
+    ecs::World<MyECS> world;
+    auto e1 = world.createEntity<Position>(Position{1, 1});
+    auto e2 = world.createEntity<Position>(Position{2, 2});
+
+    auto fork = world.clone();
+    fork.destroyEntity(e1);
+    fork.addComponent<Position, Velocity>(e2, Velocity{5, 5});
+    auto e3 = fork.createEntity<Position>(Position{3, 3});
+
+    EXPECT_EQ(2, world.getEntityCount());
+    EXPECT_EQ(2, fork.getEntityCount());
+    world.apply<Position>(e1, [](Position& pos) { EXPECT_EQ(1, pos.x); });
+    EXPECT_THROW(fork.apply<Position>(e1, [](Position&) {}), std::out_of_range);
+    EXPECT_THROW(world.apply<Velocity>(e2, [](Velocity&) {}), std::runtime_error);
+    fork.apply<Velocity>(e2, [](Velocity& vel) { EXPECT_EQ(5, vel.dx); });
+    EXPECT_THROW(world.apply<Position>(e3, [](Position&) {}), std::out_of_range);
+}
+
+// The profiler only exists with ECS_PROFILING, the unprofiled build runs the other tests
+#if defined(ECS_PROFILING)
+
+TEST(V5, testProfilerQueryZone) {
+    auto& profiler = ecs::profiler::Profiler::instance();
+    profiler.clear();
+
+    ecs::World<MyECS> world;
+    world.createEntity<Position>(Position{1, 1});
+    world.createEntity<Position, Velocity>(Position{2, 2}, Velocity{3, 3});
+    world.createEntity<Position, Velocity>(Position{4, 4}, Velocity{5, 5});
+    {
+        ECS_PROFILE_SCOPE("movement");
+        world.forEach<Position, const Velocity>([](Position& pos, const Velocity& vel) {
+            pos.x += vel.dx;
+        });
+    }
+
+    auto events = profiler.collect();
+    ASSERT_EQ(2u, events.size());
+    // the inner query finishes first
+    EXPECT_STREQ("World::forEach", events[0].name);
+    EXPECT_EQ(1u, events[0].archetypes);
+    EXPECT_EQ(2u, events[0].rows);
+    EXPECT_STREQ("movement", events[1].name);
+    EXPECT_LE(events[1].start, events[0].start);
+    EXPECT_GE(events[1].duration, events[0].duration);
+}
+
+TEST(V5, testProfilerRingBuffer) {
+    auto& profiler = ecs::profiler::Profiler::instance();
+    profiler.clear();
+    for (int i = 0; i < ECS_PROFILER_BUFFER_SIZE + 10; i++) {
+        ECS_PROFILE_SCOPE("zone");
+    }
+    EXPECT_EQ(static_cast<size_t>(ECS_PROFILER_BUFFER_SIZE), profiler.collect().size());
+}
+
+TEST(V5, testProfilerReusesThreadBuffers) {
+    auto& profiler = ecs::profiler::Profiler::instance();
+    profiler.clear();
+    // a buffer for the threads below, the next ones reuse it
+    std::thread([] { ECS_PROFILE_SCOPE("worker"); }).join();
+    size_t buffers = profiler.bufferCount();
+    for (int i = 0; i < 10; i++) {
+        std::thread([] { ECS_PROFILE_SCOPE("worker"); }).join();
+    }
+    EXPECT_EQ(buffers, profiler.bufferCount());
+
+    // the events of the exited threads stay, each with its own thread id
+    auto events = profiler.collect();
+    std::set<uint32_t> threads;
+    for (const auto& event : events) {
+        if (std::string(event.name) == "worker") threads.insert(event.thread);
+    }
+    EXPECT_EQ(11u, threads.size());
+}
+
+TEST(V5, testProfilerChromeTrace) {
+    auto& profiler = ecs::profiler::Profiler::instance();
+    profiler.clear();
+    {
+        ECS_PROFILE_SCOPE("tick");
+    }
+    std::string path = ::testing::TempDir() + "ecs_trace.json";
+    ASSERT_TRUE(profiler.writeChromeTrace(path));
+
+    std::ifstream in(path);
+    std::string json((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(0u, json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[{\"name\":\"tick\""));
+    EXPECT_NE(std::string::npos, json.find("\"ph\":\"X\""));
+}
+
+#endif
+
+TEST(V5, testStats) {
+    ecs::World<MyECS> world;
+    world.createEntity<Position>(Position{1, 1});
+    world.createEntity<Position>(Position{2, 2});
+    world.createEntity<Position, Velocity>(Position{3, 3}, Velocity{4, 4});
+
+    ecs::WorldStats stats = world.stats();
+    EXPECT_EQ(3u, stats.entities);
+    EXPECT_EQ(1u, stats.indexPages);
+    ASSERT_EQ(2u, stats.archetypes.size());
+
+    const ecs::ArchetypeStats& positions = stats.archetypes[0];
+    EXPECT_EQ(MyECS::GetComponentMask<Position>(), positions.signature);
+    EXPECT_EQ(2u, positions.rows);
+    EXPECT_EQ(2 * sizeof(ecs::EntityId), positions.entities.bytesUsed);
+    ASSERT_EQ(1u, positions.columns.size());
+    EXPECT_EQ(MyECS::GetComponentID<Position>(), positions.columns[0].component);
+    EXPECT_EQ(2 * sizeof(Position), positions.columns[0].bytesUsed);
+    EXPECT_GE(positions.columns[0].bytesReserved, positions.columns[0].bytesUsed);
+
+    const ecs::ArchetypeStats& moving = stats.archetypes[1];
+    ASSERT_EQ(2u, moving.columns.size());
+    EXPECT_EQ(MyECS::GetComponentID<Velocity>(), moving.columns[1].component);
+
+    EXPECT_EQ(3 * sizeof(Position) + sizeof(Velocity) + 3 * sizeof(ecs::EntityId),
+              stats.bytesUsed());
+    EXPECT_EQ(stats.bytesReserved() - stats.bytesUsed(), stats.slack());
+    EXPECT_GT(stats.bytesTotal(), stats.bytesReserved());
+}
+
+TEST(V5, testStatsSharedChunks) {
+    ecs::World<MyECS> world;
+    auto e1 = world.createEntity<Position>(Position{1, 1});
+    auto fork = world.clone();
+    EXPECT_EQ(1u, world.stats().archetypes[0].columns[0].sharedChunks);
+    EXPECT_EQ(world.stats().bytesReserved() + world.stats().indexBytesShared,
+              world.stats().bytesShared());
+
+    fork.apply<Position>(e1, [](Position& pos) { pos.x = 2; });
+    EXPECT_EQ(0u, world.stats().archetypes[0].columns[0].sharedChunks);
+    EXPECT_EQ(0u, world.stats().archetypes[0].columns[0].bytesShared);
+    // the entity id chunk and the index page are still shared
+    ecs::WorldStats stats = world.stats();
+    EXPECT_GT(stats.indexBytesShared, 0u);
+    EXPECT_EQ(stats.archetypes[0].entities.bytesReserved + stats.indexBytesShared,
+              stats.bytesShared());
+}
+
+TEST(V5, testStatsOutput) {
+    ecs::World<MyECS> world;
+    world.createEntity<Position, Velocity>(Position{1, 1}, Velocity{2, 2});
+    ecs::WorldStats stats = world.stats();
+
+    std::string json = stats.toJson();
+    EXPECT_EQ(0u, json.find("{\"entities\":1,"));
+    EXPECT_NE(std::string::npos, json.find("\"columns\":[{\"component\":0,"));
+
+    std::string table = stats.toTable();
+    EXPECT_EQ(0u, table.find("archetype"));
+    EXPECT_NE(std::string::npos, table.find("total: 1 entities, 1 archetypes"));
+}
+
+TEST(V5, testCompact) {
+    ecs::World<MyECS> world;
+    std::vector<ecs::EntityId> ids;
+    for (int i = 0; i < 5000; i++) {
+        ids.push_back(world.createEntity<Position, Velocity>(Position{i, i}, Velocity{i, i}));
+    }
+    auto keep = world.createEntity<Position>(Position{7, 7});
+    for (auto id : ids) world.destroyEntity(id);
+
+    EXPECT_EQ(2u, world.stats().archetypes.size());
+    EXPECT_TRUE(world.compact());
+
+    ecs::WorldStats stats = world.stats();
+    ASSERT_EQ(1u, stats.archetypes.size());
+    EXPECT_EQ(0u, stats.slack());
+    world.apply<Position>(keep, [](Position& pos) { EXPECT_EQ(7, pos.x); });
+
+    // the world stays usable, removed archetypes are created again
+    auto e = world.createEntity<Position, Velocity>(Position{1, 2}, Velocity{3, 4});
+    world.apply<Velocity>(e, [](Velocity& vel) { EXPECT_EQ(3, vel.dx); });
+    int visited = 0;
+    world.forEach<Position>([&](Position&) { visited++; });
+    EXPECT_EQ(2, visited);
+}
+
+TEST(V5, testCompactIncremental) {
+    ecs::World<MyECS> world;
+    auto e1 = world.createEntity<Position>(Position{1, 1});
+    auto e2 = world.createEntity<Velocity>(Velocity{2, 2});
+    auto e3 = world.createEntity<Position, Velocity>(Position{3, 3}, Velocity{3, 3});
+    world.destroyEntity(e1);
+    world.destroyEntity(e2);
+    world.destroyEntity(e3);
+
+    // a zero budget still makes progress, one archetype per call
+    int calls = 1;
+    while (!world.compact(std::chrono::nanoseconds(0))) calls++;
+    EXPECT_EQ(4, calls);
+    EXPECT_EQ(0u, world.stats().archetypes.size());
+}
+
+TEST(V5, testSortArchetype) {
+    ecs::World<MyECS> world;
+    std::vector<ecs::EntityId> ids;
+    const int count = static_cast<int>(ecs::detail::chunkCapacity) * 2 + 100;
+    for (int i = 0; i < count; i++) {
+        ids.push_back(world.createEntity<Position, Velocity>(Position{(i * 7919) % count, i},
+                                                             Velocity{i, 0}));
+    }
+    world.createEntity<Velocity>(Velocity{-1, 0});
+
+    world.sortArchetype<Position>(
+        [](const Position& a, const Position& b) { return a.x < b.x; });
+
+    int last = -1;
+    world.forEach<const Position, const Velocity>([&](const Position& pos, const Velocity& vel) {
+        EXPECT_LE(last, pos.x);
+        last = pos.x;
+        // the other columns moved with the key
+        EXPECT_EQ(pos.y, vel.dx);
+    });
+    // entity locations follow the rows
+    for (int i = 0; i < count; i++) {
+        world.apply<const Position>(ids[i], [&](const Position& pos) { EXPECT_EQ(i, pos.y); });
+    }
+}
+
+TEST(V5, testSortArchetypeIncremental) {
+    ecs::World<MyECS> world;
+    std::vector<ecs::EntityId> ids;
+    const int count = static_cast<int>(ecs::detail::chunkCapacity) * 5 + 3;
+    for (int i = 0; i < count; i++) {
+        ids.push_back(world.createEntity<Position>(Position{count - i, i}));
+    }
+    auto byX = [](const Position& a, const Position& b) { return a.x < b.x; };
+
+    world.sortArchetypeIncremental<Position>(1, byX);
+    bool sorted = true;
+    int last = 0;
+    world.forEach<const Position>([&](const Position& pos) {
+        sorted = sorted && last <= pos.x;
+        last = pos.x;
+    });
+    EXPECT_FALSE(sorted);
+
+    // 6 chunks: at most 6 passes of 3 chunk pairs each
+    for (int i = 0; i < 18; i++) world.sortArchetypeIncremental<Position>(1, byX);
+
+    last = 0;
+    world.forEach<const Position>([&](const Position& pos) {
+        EXPECT_LE(last, pos.x);
+        last = pos.x;
+    });
+    for (int i = 0; i < count; i++) {
+        world.apply<const Position>(ids[i], [&](const Position& pos) { EXPECT_EQ(i, pos.y); });
+    }
+}
+
+TEST(V5, testEntityRef) {
+    ecs::World<MyECS> world;
+    auto e1 = world.createEntity<Position, Velocity>(Position{1, 1}, Velocity{2, 2});
+    auto ref = world.ref<Position, const Velocity>(e1);
+    ref.apply([](Position& pos, const Velocity& vel) { pos.x += vel.dx; });
+    EXPECT_EQ(3, ref.get<Position>().x);
+    EXPECT_EQ(e1, ref.id());
+
+    // creating entities grows the chunk of the row in memory, the ref follows it
+    for (int i = 0; i < 2000; i++) {
+        world.createEntity<Position, Velocity>(Position{}, Velocity{});
+        ref.get<Position>().y = i;
+    }
+    EXPECT_EQ(3, ref.get<Position>().x);
+    world.apply<const Position>(e1, [](const Position& pos) { EXPECT_EQ(1999, pos.y); });
+}
+
+TEST(V5, testEntityRefAfterClone) {
+    ecs::World<MyECS> world;
+    auto e1 = world.createEntity<Position, Velocity>(Position{1, 1}, Velocity{2, 2});
+    auto ref = world.ref<Position, const Velocity>(e1);
+    ref.get<Position>().x = 10;
+
+    // writes through the ref detach the chunk from the clone
+    auto copy = world.clone();
+    ref.get<Position>().x = 20;
+    copy.apply<const Position>(e1, [](const Position& pos) { EXPECT_EQ(10, pos.x); });
+    world.apply<const Position>(e1, [](const Position& pos) { EXPECT_EQ(20, pos.x); });
+
+    // a read-only component in a chunk shared with the clone follows writes of either world
+    world.apply<Velocity>(e1, [](Velocity& vel) { vel.dx = 3; });
+    EXPECT_EQ(3, ref.get<const Velocity>().dx);
+    copy.apply<Velocity>(e1, [](Velocity& vel) { vel.dx = 4; });
+    EXPECT_EQ(3, ref.get<const Velocity>().dx);
+
+    // relocated chunks are looked up again
+    world.relocateChunks<Position>(0, 1);
+    ref.get<Position>().x = 30;
+    world.apply<const Position>(e1, [](const Position& pos) { EXPECT_EQ(30, pos.x); });
+    world.compact();
+    EXPECT_EQ(30, ref.get<Position>().x);
+}
+
+TEST(V5, testEntityRefAfterSnapshot) {
+    ecs::World<MyECS> world;
+    auto e1 = world.createEntity<Position>(Position{1, 1});
+    auto ref = world.ref<Position>(e1);
+    ref.get<Position>().x = 1;
+
+    // writes through the ref detach the chunk from the snapshot
+    ecs::Snapshot<MyECS, Position> snapshot;
+    world.snapshot(snapshot);
+    ref.get<Position>().x = 2;
+    snapshot.forEach<const Position>([](const Position& pos) { EXPECT_EQ(1, pos.x); });
+    world.apply<const Position>(e1, [](const Position& pos) { EXPECT_EQ(2, pos.x); });
+
+    // and keep reaching the world after a forEach wrote the chunk
+    world.snapshot(snapshot);
+    world.forEach<Position>([](Position& pos) { pos.y = 5; });
+    ref.get<Position>().x = 100;
+    world.apply<const Position>(e1, [](const Position& pos) { EXPECT_EQ(100, pos.x); });
+    snapshot.forEach<const Position>([](const Position& pos) { EXPECT_EQ(2, pos.x); });
+}
+
+TEST(V5, testEntityRefAfterStructuralChange) {
+    ecs::World<MyECS> world;
+    auto e1 = world.createEntity<Position>(Position{1, 1});
+    auto e2 = world.createEntity<Position>(Position{2, 2});
+    auto ref = world.ref<Position>(e2);
+
+    // e2 is swapped into the row of e1
+    world.destroyEntity(e1);
+    EXPECT_EQ(2, ref.get<Position>().x);
+
+    // e2 moves to another archetype
+    world.addComponent<Position, Velocity>(e2, Velocity{5, 5});
+    ref.get<Position>().x = 20;
+    world.apply<Position>(e2, [](Position& pos) { EXPECT_EQ(20, pos.x); });
+
+    world.destroyEntity(e2);
+    EXPECT_THROW(ref.get<Position>(), std::out_of_range);
+}
+
+TEST(V5, testEntityRefAfterCompact) {
+    ecs::World<MyECS> world;
+    auto e1 = world.createEntity<Position>(Position{1, 1});
+    auto e2 = world.createEntity<Position>(Position{2, 2});
+    world.createEntity<Position>(Position{3, 3});
+    auto ref = world.ref<Position>(e2);
+    world.destroyEntity(e1);
+
+    // shrinking the last chunk moves the row of the ref
+    EXPECT_TRUE(world.compact());
+    Position* address = nullptr;
+    world.apply<Position>(e2, [&](Position& pos) { address = &pos; });
+    EXPECT_EQ(address, &ref.get<Position>());
+
+    // a compact that has nothing to shrink moves no row
+    EXPECT_TRUE(world.compact());
+    ref.get<Position>().x = 20;
+    world.apply<const Position>(e2, [](const Position& pos) { EXPECT_EQ(20, pos.x); });
+}
+
+TEST(V5, testEntityRefMissingComponent) {
+    ecs::World<MyECS> world;
+    auto e1 = world.createEntity<Position>(Position{1, 1});
+    EXPECT_THROW(world.ref<Velocity>(e1), std::runtime_error);
+    EXPECT_THROW(world.ref<Position>(e1 + 1), std::out_of_range);
+}
+
+TEST(V5, testApplyBatch) {
+    ecs::World<MyECS> world;
+    std::vector<ecs::EntityId> ids;
+    for (int i = 0; i < 3000; i++) {
+        if (i % 3 == 0) {
+            ids.push_back(world.createEntity<Position>(Position{i, 0}));
+        } else {
+            ids.push_back(world.createEntity<Position, Velocity>(Position{i, 0}, Velocity{1, 1}));
+        }
+    }
+    std::reverse(ids.begin(), ids.end());
+    std::vector<ecs::EntityId> batch(ids.begin(), ids.begin() + 2000);
+    // duplicates are applied twice
+    batch.push_back(batch.front());
+
+    int calls = 0;
+    world.applyBatch<Position>(batch, [&](Position& pos) {
+        pos.y += 1;
+        calls++;
+    });
+    EXPECT_EQ(2001, calls);
+    for (size_t i = 0; i < ids.size(); i++) {
+        int expected = i < 2000 ? 1 : 0;
+        if (i == 0) expected = 2;
+        world.apply<const Position>(ids[i],
+                                    [&](const Position& pos) { EXPECT_EQ(expected, pos.y); });
+    }
+
+    // the rows of each archetype are visited in the order of forEach, whatever the id order
+    std::map<const Position*, size_t> order;
+    world.forEach<const Position>([&](const Position& pos) { order.emplace(&pos, order.size()); });
+    std::shuffle(ids.begin(), ids.end(), std::mt19937(7));
+    std::vector<size_t> visits;
+    world.applyBatch<const Position>(ids,
+                                     [&](const Position& pos) { visits.push_back(order[&pos]); });
+    ASSERT_EQ(ids.size(), visits.size());
+    size_t descents = 0;
+    for (size_t i = 1; i < visits.size(); i++) descents += visits[i] < visits[i - 1];
+    // one where the second archetype starts, if it comes first in forEach
+    EXPECT_LE(descents, 1u);
+}
+
+TEST(V5, testApplyBatchChecksAllIdsFirst) {
+    ecs::World<MyECS> world;
+    auto e1 = world.createEntity<Position, Velocity>(Position{1, 1}, Velocity{1, 1});
+    auto e2 = world.createEntity<Position>(Position{2, 2});
+    std::vector<ecs::EntityId> missing{e1, e2 + 10};
+    std::vector<ecs::EntityId> mismatch{e1, e2};
+
+    int calls = 0;
+    EXPECT_THROW(world.applyBatch<Position>(missing, [&](Position&) { calls++; }),
+                 std::out_of_range);
+    EXPECT_THROW(world.applyBatch<Velocity>(mismatch, [&](Velocity&) { calls++; }),
+                 std::runtime_error);
+    EXPECT_EQ(0, calls);
+}
+
+TEST(V5, testForEachInRange) {
+    ecs::World<MyECS> world;
+    for (int i = 0; i < 3000; i++) {
+        if (i % 2 == 0) {
+            world.createEntity<Position>(Position{i, 0});
+        } else {
+            world.createEntity<Position, Velocity>(Position{i, 0}, Velocity{1, 1});
+        }
+    }
+    world.createEntity<Velocity>(Velocity{2, 2});
+    EXPECT_EQ(3000, world.count<Position>());
+    EXPECT_EQ(1501, world.count<const Velocity>());
+
+    std::vector<int> all;
+    world.forEach<const Position>([&](const Position& pos) { all.push_back(pos.x); });
+
+    // disjoint ranges cover the rows of forEach in the same order
+    std::vector<int> parts;
+    size_t bounds[] = {0, 1000, 1500, 2100, 5000};
+    for (size_t b = 0; b + 1 < std::size(bounds); b++) {
+        world.forEachInRange<const Position>(bounds[b], bounds[b + 1],
+                                             [&](const Position& pos) { parts.push_back(pos.x); });
+    }
+    EXPECT_EQ(all, parts);
+
+    int calls = 0;
+    world.forEachInRange<Position>(2000, 2000, [&](Position&) { calls++; });
+    EXPECT_EQ(0, calls);
+}
+
+TEST(V5, testParallelWritesAfterClone) {
+    ecs::World<MyECS> world;
+    for (int i = 0; i < 3000; i++) {
+        world.createEntity<Position, Velocity>(Position{i, 0}, Velocity{1, 1});
+    }
+    auto fork = world.clone();
+
+    // the bounds split chunks, so several threads write parts of one chunk shared with the fork
+    size_t bounds[] = {0, 300, 700, 1024, 1500, 2100, 3000};
+    world.detachChunks<Position, const Velocity>(0, 3000);
+    std::vector<std::thread> threads;
+    for (size_t b = 0; b + 1 < std::size(bounds); b++) {
+        threads.emplace_back([&, b] {
+            world.forEachInRange<Position, const Velocity>(
+                bounds[b], bounds[b + 1],
+                [](Position& pos, const Velocity& vel) { pos.y += vel.dy; });
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    // the read-only Velocity chunks stay shared
+    ecs::WorldStats stats = world.stats();
+    ASSERT_EQ(1u, stats.archetypes.size());
+    EXPECT_EQ(0u, stats.archetypes[0].columns[0].sharedChunks);
+    EXPECT_EQ(3u, stats.archetypes[0].columns[1].sharedChunks);
+
+    // a view detaches when created
+    auto second = fork.clone();
+    auto view = fork.view<Position>();
+    std::for_each(std::execution::par, view.begin(), view.end(),
+                  [](auto row) { std::get<0>(row).y += 2; });
+
+    world.forEach<const Position>([](const Position& pos) { EXPECT_EQ(1, pos.y); });
+    fork.forEach<const Position>([](const Position& pos) { EXPECT_EQ(2, pos.y); });
+    second.forEach<const Position>([](const Position& pos) { EXPECT_EQ(0, pos.y); });
+}
+
+TEST(V5, testAddComponentToAll) {
+    ecs::World<MyECS> world;
+    std::vector<ecs::EntityId> ids;
+    for (int i = 0; i < 2500; i++) ids.push_back(world.createEntity<Position>(Position{i, i}));
+    auto moving = world.createEntity<Position, Velocity>(Position{-1, -1}, Velocity{5, 5});
+
+    // the target archetype holds one row, so the rows are copied behind it
+    EXPECT_EQ(2500, (world.addComponentToAll<Position, Velocity>(Velocity{1, 2})));
+    EXPECT_EQ(0, (world.addComponentToAll<Position, Velocity>(Velocity{1, 2})));
+    EXPECT_EQ(2501, world.count<Velocity>());
+    for (int i = 0; i < 2500; i++) {
+        world.apply<const Position, const Velocity>(
+            ids[i], [&](const Position& pos, const Velocity& vel) {
+                EXPECT_EQ(i, pos.x);
+                EXPECT_EQ(1, vel.dx);
+                EXPECT_EQ(2, vel.dy);
+            });
+    }
+    world.apply<const Velocity>(moving, [](const Velocity& vel) { EXPECT_EQ(5, vel.dx); });
+
+    // entities keep working after the move
+    world.destroyEntity(ids[0]);
+    EXPECT_EQ(2500, (world.count<Position, Velocity>()));
+    EXPECT_THROW(world.apply<Position>(ids[0], [](Position&) {}), std::out_of_range);
+}
+
+TEST(V5, testRemoveComponentFromAll) {
+    ecs::World<MyECS> world;
+    std::vector<ecs::EntityId> ids;
+    for (int i = 0; i < 2500; i++) {
+        ids.push_back(world.createEntity<Position, Velocity>(Position{i, 0}, Velocity{i, i}));
+    }
+    auto fork = world.clone();
+
+    // the target archetype is empty, the chunks are taken over
+    EXPECT_EQ(2500, (world.removeComponentFromAll<Position, Velocity>()));
+    EXPECT_EQ(0, world.count<Velocity>());
+    EXPECT_EQ(2500, world.count<Position>());
+    for (int i = 0; i < 2500; i++) {
+        world.apply<const Position>(ids[i], [&](const Position& pos) { EXPECT_EQ(i, pos.x); });
+        EXPECT_THROW(world.apply<Velocity>(ids[i], [](Velocity&) {}), std::runtime_error);
+    }
+
+    // writes after the move do not reach the clone
+    world.forEach<Position>([](Position& pos) { pos.y = 7; });
+    EXPECT_EQ(2500, fork.count<Velocity>());
+    fork.apply<const Position, const Velocity>(ids[42],
+                                               [](const Position& pos, const Velocity& vel) {
+                                                   EXPECT_EQ(0, pos.y);
+                                                   EXPECT_EQ(42, vel.dx);
+                                               });
+
+    // and back again
+    EXPECT_EQ(2500, (world.addComponentToAll<Position, Velocity>(Velocity{3, 3})));
+    world.apply<const Velocity>(ids[100], [](const Velocity& vel) { EXPECT_EQ(3, vel.dx); });
+}
+
+TEST(V5, testForEachFused) {
+    ecs::World<MyECS> world;
+    std::vector<ecs::EntityId> ids;
+    for (int i = 0; i < 3000; i++) {
+        if (i % 3 == 0) {
+            ids.push_back(world.createEntity<Position>(Position{i, 0}));
+        } else {
+            ids.push_back(world.createEntity<Position, Velocity>(Position{i, 0}, Velocity{1, 2}));
+        }
+    }
+    auto separate = world.clone();
+
+    auto move = [](Position& pos, const Velocity& vel) {
+        pos.x += vel.dx;
+        pos.y += vel.dy;
+    };
+    long sumFused = 0, sumSeparate = 0;
+    int visited = 0;
+    world.forEachFused(ecs::makeSystem<Position, const Velocity>(move),
+                       ecs::makeSystem<const Position>([&](const Position& pos) {
+                           sumFused += pos.x + pos.y;
+                           visited++;
+                       }));
+    separate.forEach<Position, const Velocity>(move);
+    separate.forEach<const Position>([&](const Position& pos) { sumSeparate += pos.x + pos.y; });
+
+    // every entity once, the second system sees the moved positions
+    EXPECT_EQ(3000, visited);
+    EXPECT_EQ(sumSeparate, sumFused);
+    for (auto id : ids) {
+        world.apply<const Position>(id, [&](const Position& a) {
+            separate.apply<const Position>(id, [&](const Position& b) {
+                EXPECT_EQ(b.x, a.x);
+                EXPECT_EQ(b.y, a.y);
+            });
+        });
+    }
+}
+
+TEST(V5, testObserverBatchedOnSync) {
+    ecs::World<MyECS> world;
+    std::vector<ecs::EntityId> added;
+    std::vector<int> positions;
+    int calls = 0;
+    world.observe<ecs::ObserverEvent::OnAdd, Position, Velocity>(
+        [&](std::span<const ecs::EntityId> ids, std::span<const Position> pos,
+            std::span<const Velocity> vel) {
+            calls++;
+            EXPECT_EQ(ids.size(), pos.size());
+            EXPECT_EQ(ids.size(), vel.size());
+            for (size_t i = 0; i < ids.size(); i++) {
+                added.push_back(ids[i]);
+                positions.push_back(pos[i].x);
+            }
+        });
+
+    auto a = world.createEntity<Position, Velocity>(Position{1, 0}, Velocity{0, 0});
+    auto b = world.createEntity<Position>(Position{2, 0});
+    auto c = world.createEntity<Position, Velocity>(Position{3, 0}, Velocity{0, 0});
+    world.addComponent<Position, Velocity>(b, Velocity{0, 0});
+
+    // nothing is delivered before the sync point
+    EXPECT_EQ(0, calls);
+    world.sync();
+    EXPECT_EQ(1, calls);
+    EXPECT_EQ((std::vector<ecs::EntityId>{a, c, b}), added);
+    EXPECT_EQ((std::vector<int>{1, 3, 2}), positions);
+
+    // no new events, no call
+    world.sync();
+    EXPECT_EQ(1, calls);
+}
+
+TEST(V5, testObserverOnRemove) {
+    ecs::World<MyECS> world;
+    std::vector<ecs::EntityId> removed;
+    std::vector<int> velocities;
+    world.observe<ecs::ObserverEvent::OnRemove, Velocity>(
+        [&](std::span<const ecs::EntityId> ids, std::span<const Velocity> vel) {
+            removed.insert(removed.end(), ids.begin(), ids.end());
+            for (const auto& v : vel) velocities.push_back(v.dx);
+        });
+
+    auto a = world.createEntity<Position, Velocity>(Position{0, 0}, Velocity{10, 0});
+    auto b = world.createEntity<Position, Velocity>(Position{0, 0}, Velocity{20, 0});
+    auto c = world.createEntity<Position>(Position{0, 0});
+    world.removeComponent<Velocity>(a);
+    world.destroyEntity(c);  // has no Velocity
+    world.destroyEntity(b);
+    world.sync();
+    EXPECT_EQ((std::vector<ecs::EntityId>{a, b}), removed);
+    EXPECT_EQ((std::vector<int>{10, 20}), velocities);
+
+    // the entity kept its other components
+    EXPECT_EQ(1, world.getEntityCount());
+    world.apply<const Position>(a, [](const Position&) {});
+    EXPECT_THROW(world.apply<Velocity>(a, [](Velocity&) {}), std::runtime_error);
+}
+
+TEST(V5, testObserverOnSet) {
+    ecs::World<MyECS> world;
+    std::vector<int> values;
+    world.observe<ecs::ObserverEvent::OnSet, Position>(
+        [&](std::span<const ecs::EntityId>, std::span<const Position> pos) {
+            for (const auto& p : pos) values.push_back(p.x);
+        });
+
+    auto a = world.createEntity<Position>(Position{1, 0});
+    world.set(a, Position{2, 0});
+    // writes no Position
+    world.addComponent<Position, Velocity>(a, Velocity{0, 0});
+    world.apply<Position>(a, [](Position& pos) { pos.x = 99; });
+    world.set(a, Velocity{5, 5});
+    world.sync();
+    EXPECT_EQ((std::vector<int>{1, 2}), values);
+    EXPECT_THROW(world.set(world.createEntity<Velocity>(Velocity{0, 0}), Position{0, 0}),
+                 std::runtime_error);
+}
+
+TEST(V5, testObserverBulkOperations) {
+    ecs::World<MyECS> world;
+    size_t added = 0, removed = 0;
+    world.observe<ecs::ObserverEvent::OnAdd, Velocity>(
+        [&](std::span<const ecs::EntityId> ids, std::span<const Velocity> vel) {
+            added += ids.size();
+            for (const auto& v : vel) EXPECT_EQ(4, v.dx);
+        });
+    world.observe<ecs::ObserverEvent::OnRemove, Position, Velocity>(
+        [&](std::span<const ecs::EntityId> ids, std::span<const Position>,
+            std::span<const Velocity>) { removed += ids.size(); });
+
+    for (int i = 0; i < 3000; i++) world.createEntity<Position>(Position{i, 0});
+    EXPECT_EQ(3000, (world.addComponentToAll<Position, Velocity>(Velocity{4, 0})));
+    EXPECT_EQ(3000, (world.removeComponentFromAll<Position, Velocity>()));
+    world.sync();
+    EXPECT_EQ(3000, added);
+    EXPECT_EQ(3000, removed);
+}
+
+TEST(V5, testObserverEventsDuringSync) {
+    ecs::World<MyECS> world;
+    int destroyed = 0;
+    world.observe<ecs::ObserverEvent::OnAdd, Velocity>(
+        [&](std::span<const ecs::EntityId> ids, std::span<const Velocity>) {
+            for (auto id : ids) world.destroyEntity(id);
+        });
+    world.observe<ecs::ObserverEvent::OnRemove, Velocity>(
+        [&](std::span<const ecs::EntityId> ids, std::span<const Velocity>) {
+            destroyed += static_cast<int>(ids.size());
+        });
+
+    world.createEntity<Velocity>(Velocity{0, 0});
+    world.createEntity<Velocity>(Velocity{0, 0});
+    world.sync();
+    EXPECT_EQ(0, world.getEntityCount());
+    // the removals raised by the first observer wait for the next sync
+    EXPECT_EQ(0, destroyed);
+    world.sync();
+    EXPECT_EQ(2, destroyed);
+}
+
+TEST(V5, testSnapshot) {
+    ecs::World<MyECS> world;
+    for (int i = 0; i < 3000; i++) {
+        if (i % 2 == 0) {
+            world.createEntity<Position>(Position{i, 0});
+        } else {
+            world.createEntity<Position, Velocity>(Position{i, 0}, Velocity{i, 0});
+        }
+    }
+    ecs::Snapshot<MyECS, Position, Velocity> snapshot;
+    world.snapshot(snapshot);
+    EXPECT_EQ(3000, snapshot.count<Position>());
+    EXPECT_EQ(1500, (snapshot.count<Position, Velocity>()));
+
+    // the snapshot keeps the values of the time it was taken
+    world.forEach<Position>([](Position& pos) { pos.y = 1; });
+    world.destroyEntity(0);
+    int visited = 0;
+    snapshot.forEach<const Position>([&](const Position& pos) {
+        EXPECT_EQ(0, pos.y);
+        visited++;
+    });
+    EXPECT_EQ(3000, visited);
+
+    // rows in the order of World::forEach
+    std::vector<int> fromWorld, fromSnapshot;
+    world.snapshot(snapshot);
+    world.forEachInRange<const Position, const Velocity>(
+        100, 1200, [&](const Position& pos, const Velocity&) { fromWorld.push_back(pos.x); });
+    snapshot.forEachInRange<Position, Velocity>(
+        100, 1200, [&](const Position& pos, const Velocity&) { fromSnapshot.push_back(pos.x); });
+    EXPECT_EQ(1100, fromWorld.size());
+    EXPECT_EQ(fromWorld, fromSnapshot);
+}
+
+TEST(V5, testSnapshotSharesUnwrittenChunks) {
+    ecs::World<MyECS> world;
+    for (int i = 0; i < 5000; i++) {
+        world.createEntity<Position, Velocity>(Position{i, 0}, Velocity{0, 0});
+    }
+    ecs::Snapshot<MyECS, Position, Velocity> snapshot;
+    world.snapshot(snapshot);
+    auto shared = [&] {
+        size_t total = 0;
+        for (const auto& arch : world.stats().archetypes) {
+            for (const auto& column : arch.columns) total += column.sharedChunks;
+        }
+        return total;
+    };
+    size_t before = shared();
+    EXPECT_GT(before, 2);
+    // writing one row copies only its Position chunk
+    world.apply<Position>(4999, [](Position& pos) { pos.y = 1; });
+    EXPECT_EQ(before - 1, shared());
+}
+
+TEST(V5, testSnapshotBuffer) {
+    ecs::World<MyECS> world;
+    for (int i = 0; i < 10000; i++) world.createEntity<Position>(Position{0, 0});
+    ecs::SnapshotBuffer<MyECS, Position> buffer;
+    EXPECT_EQ(0, buffer.acquire().count<Position>());
+
+    // the reader always sees a complete tick: all positions equal
+    constexpr int ticks = 200;
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::thread reader([&] {
+        int last = 0;
+        while (!done.load()) {
+            const auto& snapshot = buffer.acquire();
+            int first = -1;
+            snapshot.forEach<Position>([&](const Position& pos) {
+                if (first < 0) first = pos.x;
+                if (pos.x != first) torn++;
+            });
+            if (first >= 0 && first < last) torn++;
+            last = std::max(last, first);
+        }
+    });
+    for (int tick = 1; tick <= ticks; tick++) {
+        world.forEach<Position>([&](Position& pos) { pos.x = tick; });
+        buffer.publish(world);
+    }
+    done = true;
+    reader.join();
+    EXPECT_EQ(0, torn.load());
+
+    const auto& latest = buffer.acquire();
+    latest.forEach<Position>([&](const Position& pos) { EXPECT_EQ(ticks, pos.x); });
+}
+
+TEST(V5, testTakeAndInsertRows) {
+    ecs::IdAllocator ids;
+    ecs::World<MyECS> left(ids), right(ids);
+    std::vector<ecs::EntityId> leftIds, rightIds;
+    for (int i = 0; i < 3000; i++) {
+        leftIds.push_back(left.createEntity<Position, Velocity>(Position{i, 0}, Velocity{i, i}));
+        rightIds.push_back(right.createEntity<Position>(Position{i, 1}));
+    }
+    // the worlds share one id space
+    for (auto id : rightIds) EXPECT_FALSE(left.contains(id));
+
+    std::vector<ecs::EntityRows> out(2);
+    size_t taken = left.takeRows<Position>(
+        [](const Position& pos) -> size_t { return pos.x % 3 == 0 ? 1 : 2; }, out);
+    EXPECT_EQ(1000, taken);
+    EXPECT_EQ(1000, out[1].size());
+    EXPECT_TRUE(out[0].empty());
+    EXPECT_EQ(2000, left.getEntityCount());
+
+    right.insertRows(out[1]);
+    EXPECT_TRUE(out[1].empty());
+    EXPECT_EQ(4000, right.getEntityCount());
+    for (int i = 0; i < 3000; i++) {
+        auto& world = i % 3 == 0 ? right : left;
+        world.apply<const Position, const Velocity>(
+            leftIds[i], [&](const Position& pos, const Velocity& vel) {
+                EXPECT_EQ(i, pos.x);
+                EXPECT_EQ(i, vel.dy);
+            });
+        EXPECT_EQ(i % 3 != 0, left.contains(leftIds[i]));
+    }
+    EXPECT_EQ(1000, (right.count<Position, Velocity>()));
+}
+
+TEST(V5, testShardedWorldMigrate) {
+    constexpr size_t shards = 4;
+    ecs::ShardedWorld<MyECS> world(shards);
+    std::vector<ecs::EntityId> ids;
+    for (int i = 0; i < 4000; i++) {
+        ids.push_back(world.createEntity<Position, Velocity>(i % shards, Position{i, 0},
+                                                             Velocity{1, 0}));
+    }
+    std::vector<ecs::EntityId> sorted = ids;
+    std::sort(sorted.begin(), sorted.end());
+    EXPECT_TRUE(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+
+    // shard by x band of 1000
+    auto shardOf = [](const Position& pos) { return static_cast<size_t>(pos.x / 1000) % shards; };
+    EXPECT_EQ(3000, world.migrate<Position>(shardOf));
+    EXPECT_EQ(4000, world.getEntityCount());
+    for (size_t s = 0; s < shards; s++) {
+        EXPECT_EQ(1000, world.shard(s).getEntityCount());
+        world.shard(s).forEach<const Position>(
+            [&](const Position& pos) { EXPECT_EQ(s, shardOf(pos)); });
+    }
+
+    // move everything by 1, the entities at a band border cross it
+    for (int tick = 0; tick < 3; tick++) {
+        world.forEach<Position, const Velocity>([](Position& pos, const Velocity& vel) {
+            pos.x += vel.dx;
+        });
+        EXPECT_EQ(shards, world.migrate<Position>(shardOf));
+    }
+    for (int i = 0; i < 4000; i++) {
+        EXPECT_EQ(shardOf(Position{i + 3, 0}), world.findShard(ids[i]));
+        world.apply<const Position>(ids[i], [&](const Position& pos) { EXPECT_EQ(i + 3, pos.x); });
+    }
+    EXPECT_THROW(world.findShard(100000), std::out_of_range);
+
+    // a failing shardOf neither deadlocks nor loses the entities taken before it threw
+    auto failing = [&](const Position& pos) {
+        if (pos.x == 2500) throw std::runtime_error("no shard");
+        return shardOf(Position{pos.x + 1000, 0});
+    };
+    EXPECT_THROW(world.migrate<Position>(failing), std::runtime_error);
+    EXPECT_EQ(4000, world.getEntityCount());
+    world.migrate<Position>(shardOf);
+    for (int i = 0; i < 4000; i++) {
+        EXPECT_EQ(shardOf(Position{i + 3, 0}), world.findShard(ids[i]));
+    }
+}
+
+TEST(V5, testShardedWorldRun) {
+    ecs::ShardedWorld<MyECS> world(3);
+    std::vector<std::thread::id> first(3), second(3);
+    world.run([&](size_t s, auto&) { first[s] = std::this_thread::get_id(); });
+    world.run([&](size_t s, auto&) { second[s] = std::this_thread::get_id(); });
+    // every shard keeps its own thread
+    EXPECT_EQ(first, second);
+    for (size_t s = 0; s < 3; s++) {
+        EXPECT_EQ(world.threadOf(s), first[s]);
+        EXPECT_NE(std::this_thread::get_id(), first[s]);
+    }
+    EXPECT_NE(first[0], first[1]);
+    EXPECT_NE(first[1], first[2]);
+
+    auto failing = [](size_t s, auto&) {
+        if (s == 1) throw std::runtime_error("shard failed");
+    };
+    EXPECT_THROW(world.run(failing), std::runtime_error);
+    world.run([&](size_t s, auto&) { EXPECT_EQ(first[s], std::this_thread::get_id()); });
+}
+
+TEST(V5, testSpawner) {
+    ecs::World<MyECS> world;
+    auto first = world.createEntity<Position>(Position{-1, 0});
+    size_t added = 0;
+    world.observe<ecs::ObserverEvent::OnAdd, Position>(
+        [&](std::span<const ecs::EntityId> ids, std::span<const Position>) {
+            added += ids.size();
+        });
+
+    auto& spawner = world.spawner();
+    std::vector<ecs::EntityId> ids;
+    for (int i = 0; i < 3000; i++) {
+        if (i % 2 == 0) {
+            ids.push_back(spawner.createEntity<Position>(Position{i, 0}));
+        } else {
+            ids.push_back(spawner.createEntity<Position, Velocity>(Position{i, 0}, Velocity{i, 0}));
+        }
+    }
+    auto second = world.createEntity<Position>(Position{-2, 0});
+    EXPECT_NE(first, second);
+    for (auto id : ids) EXPECT_NE(second, id);
+
+    // staged until the sync point
+    EXPECT_EQ(3000, spawner.size());
+    EXPECT_EQ(2, world.getEntityCount());
+    EXPECT_FALSE(world.contains(ids[0]));
+    world.sync();
+    EXPECT_EQ(0, spawner.size());
+    EXPECT_EQ(3002, world.getEntityCount());
+    EXPECT_EQ(3001, added);
+    for (int i = 0; i < 3000; i++) {
+        world.apply<const Position>(ids[i], [&](const Position& pos) { EXPECT_EQ(i, pos.x); });
+    }
+    EXPECT_EQ(1500, world.count<Velocity>());
+}
+
+TEST(V5, testSpawnerThreads) {
+    ecs::World<MyECS> world;
+    constexpr int threads = 4, perThread = 5000;
+    std::vector<ecs::Spawner<MyECS>*> spawners;
+    for (int t = 0; t < threads; t++) spawners.push_back(&world.spawner());
+
+    std::vector<std::vector<ecs::EntityId>> ids(threads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < perThread; i++) {
+                ids[t].push_back(
+                    spawners[t]->createEntity<Position, Velocity>(Position{t, i}, Velocity{0, 0}));
+            }
+        });
+    }
+    // the world keeps running while the workers spawn
+    world.createEntity<Position>(Position{-1, -1});
+    for (auto& worker : workers) worker.join();
+    world.sync();
+
+    EXPECT_EQ(threads * perThread + 1, world.getEntityCount());
+    std::vector<ecs::EntityId> all;
+    for (int t = 0; t < threads; t++) {
+        all.insert(all.end(), ids[t].begin(), ids[t].end());
+        for (int i = 0; i < perThread; i += 97) {
+            world.apply<const Position>(ids[t][i], [&](const Position& pos) {
+                EXPECT_EQ(t, pos.x);
+                EXPECT_EQ(i, pos.y);
+            });
+        }
+    }
+    std::sort(all.begin(), all.end());
+    EXPECT_TRUE(std::adjacent_find(all.begin(), all.end()) == all.end());
+}
+
+namespace {
+
+// Adds 1 to the y of every Position, 100 rows per tick.
+ecs::Task slowIncrement(ecs::Scheduler& scheduler, ecs::World<MyECS>& world, int& ticks) {
+    size_t total = world.count<Position>();
+    for (size_t cursor = 0; cursor < total; cursor += 100) {
+        world.forEachInRange<Position>(cursor, cursor + 100, [](Position& pos) { pos.y++; });
+        ticks++;
+        co_await scheduler.nextTick();
+    }
+}
+
+ecs::Task countAfter(ecs::SystemHandle other, ecs::World<MyECS>& world, int& sum) {
+    co_await other;
+    world.forEach<const Position>([&](const Position& pos) { sum += pos.y; });
+}
+
+ecs::Task throwing(ecs::Scheduler& scheduler) {
+    co_await scheduler.nextTick();
+    throw std::runtime_error("system failed");
+}
+
+}  // namespace
+
+TEST(V5, testCoroutineSystem) {
+    ecs::World<MyECS> world;
+    for (int i = 0; i < 1000; i++) world.createEntity<Position>(Position{i, 0});
+    ecs::Scheduler scheduler;
+    int ticks = 0, sum = 0;
+    auto increment = scheduler.spawn(slowIncrement(scheduler, world, ticks));
+    scheduler.spawn(countAfter(increment, world, sum));
+    EXPECT_EQ(2, scheduler.size());
+
+    // spawned systems start with the next tick, the cursor survives across ticks
+    EXPECT_EQ(0, ticks);
+    for (int tick = 1; tick <= 10; tick++) {
+        scheduler.tick();
+        EXPECT_EQ(tick, ticks);
+        EXPECT_FALSE(increment.done());
+    }
+    EXPECT_EQ(0, sum);
+    // the last resume leaves the loop, the waiting system runs in the same tick
+    scheduler.tick();
+    EXPECT_TRUE(increment.done());
+    EXPECT_EQ(1000, sum);
+    EXPECT_EQ(0, scheduler.size());
+}
+
+TEST(V5, testCoroutineBudget) {
+    ecs::Scheduler scheduler;
+    std::vector<int> perTick;
+    auto budgeted = [](ecs::Scheduler& scheduler, std::vector<int>& perTick) -> ecs::Task {
+        for (int i = 0; i < 5; i++) {
+            perTick.back()++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            // over budget after every step
+            co_await scheduler.budget(std::chrono::milliseconds(1));
+        }
+        for (int i = 0; i < 5; i++) {
+            perTick.back()++;
+            // plenty of budget: no suspension
+            co_await scheduler.budget(std::chrono::hours(1));
+        }
+    };
+    scheduler.spawn(budgeted(scheduler, perTick));
+    while (scheduler.size() > 0) {
+        perTick.push_back(0);
+        scheduler.tick();
+    }
+    EXPECT_EQ((std::vector<int>{1, 1, 1, 1, 1, 5}), perTick);
+}
+
+TEST(V5, testCoroutineThreadsAndErrors) {
+    ecs::Scheduler scheduler(4);
+    std::atomic<int> resumes{0};
+    auto loop = [](ecs::Scheduler& scheduler, std::atomic<int>& resumes) -> ecs::Task {
+        for (int i = 0; i < 3; i++) {
+            resumes++;
+            co_await scheduler.nextTick();
+        }
+    };
+    for (int i = 0; i < 16; i++) scheduler.spawn(loop(scheduler, resumes));
+    scheduler.tick();
+    EXPECT_EQ(16, resumes.load());
+
+    scheduler.spawn(throwing(scheduler));
+    scheduler.tick();
+    // the other systems still ran in the failing tick
+    EXPECT_THROW(scheduler.tick(), std::runtime_error);
+    EXPECT_EQ(48, resumes.load());
+    EXPECT_EQ(16, scheduler.size());
+    scheduler.tick();
+    EXPECT_EQ(0, scheduler.size());
+
+    // every tick resumes the systems on the same 4 threads
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    auto record = [](ecs::Scheduler& scheduler, std::mutex& mutex,
+                     std::set<std::thread::id>& threads) -> ecs::Task {
+        for (int i = 0; i < 3; i++) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                threads.insert(std::this_thread::get_id());
+            }
+            co_await scheduler.nextTick();
+        }
+    };
+    for (int i = 0; i < 16; i++) scheduler.spawn(record(scheduler, mutex, threads));
+    for (int tick = 0; tick < 4; tick++) scheduler.tick();
+    EXPECT_EQ(4, threads.size());
+    EXPECT_EQ(1, threads.count(std::this_thread::get_id()));
+
+    // unfinished systems are destroyed with the scheduler
+    ecs::Scheduler other;
+    other.spawn(loop(other, resumes));
+    other.tick();
+}
+
+TEST(V5, testDynamicComponents) {
+    ecs::World<MyECS> world;
+    // a plain layout as a script would define it, and a C++ type with a destructor
+    auto hp = world.registerComponent(ecs::ComponentInfo{"hp", sizeof(int), alignof(int)});
+    auto name = world.registerComponent(ecs::ComponentInfo::of<std::string>("name"));
+    EXPECT_EQ(2, hp.id);
+    EXPECT_EQ("name", world.componentInfo(name).name);
+
+    std::vector<ecs::EntityId> ids;
+    for (int i = 0; i < 3000; i++) {
+        ecs::EntityId id = world.createEntity<Position>(Position{i, 0});
+        int value = i;
+        world.addComponent(id, hp, &value);
+        if (i % 2 == 0) {
+            std::string text = "entity " + std::to_string(i);
+            world.addComponent(id, name, &text);
+        }
+        ids.push_back(id);
+    }
+    EXPECT_EQ(1000, *static_cast<int*>(world.get(ids[1000], hp)));
+    EXPECT_EQ("entity 1000", *static_cast<std::string*>(world.get(ids[1000], name)));
+    EXPECT_THROW(world.get(ids[1], name), std::runtime_error);
+
+    // mixed query: typed Position plus both runtime components
+    std::vector<ecs::DynamicComponent> query{hp, name};
+    int visited = 0;
+    world.forEach<Position>(query, [&](Position& pos, ecs::DynamicRow row) {
+        EXPECT_EQ(2, row.size());
+        EXPECT_EQ(pos.x, row.get<int>(0));
+        EXPECT_EQ("entity " + std::to_string(pos.x), row.get<std::string>(1));
+        row.get<int>(0) += 1;
+        visited++;
+    });
+    EXPECT_EQ(1500, visited);
+
+    // adding a typed component keeps the runtime ones, removing swaps the last row in
+    world.addComponent<Position, Velocity>(ids[2], Velocity{1, 1});
+    EXPECT_EQ(3, *static_cast<int*>(world.get(ids[2], hp)));
+    EXPECT_EQ("entity 2", *static_cast<std::string*>(world.get(ids[2], name)));
+    world.removeComponent(ids[4], name);
+    world.destroyEntity(ids[6]);
+    EXPECT_THROW(world.get(ids[4], name), std::runtime_error);
+    EXPECT_EQ(5, *static_cast<int*>(world.get(ids[4], hp)));
+    EXPECT_EQ("entity 2998", *static_cast<std::string*>(world.get(ids[2998], name)));
+
+    // overwrite, and a clone keeps its own copy
+    ecs::World<MyECS> copy = world.clone();
+    std::string renamed = "renamed";
+    world.addComponent(ids[8], name, &renamed);
+    EXPECT_EQ("renamed", *static_cast<std::string*>(world.get(ids[8], name)));
+    EXPECT_EQ("entity 8", *static_cast<std::string*>(copy.get(ids[8], name)));
+
+    // sorting permutes the runtime columns with the typed ones
+    world.sortArchetype<Position>([](const Position& a, const Position& b) { return a.x > b.x; });
+    std::vector<ecs::DynamicComponent> hpOnly{hp};
+    world.forEach<const Position>(hpOnly, [&](const Position& pos, ecs::DynamicRow row) {
+        EXPECT_EQ(pos.x % 2 == 0 ? pos.x + 1 : pos.x, row.get<int>(0));
+    });
+    for (int i = 0; i < 3000; i += 2) {
+        if (i == 6) continue;
+        EXPECT_EQ(i + 1, *static_cast<int*>(world.get(ids[i], hp)));
+    }
+    EXPECT_EQ("entity 2998", *static_cast<std::string*>(world.get(ids[2998], name)));
+
+    // only runtime components
+    visited = 0;
+    world.forEach<>(hpOnly, [&](ecs::DynamicRow) { visited++; });
+    EXPECT_EQ(2999, visited);
+}
+
+TEST(V5, testDynamicComponentLimits) {
+    ecs::World<MyECS> world;
+    EXPECT_THROW(world.registerComponent(ecs::ComponentInfo{"odd", 4, 3}), std::invalid_argument);
+    ecs::ComponentInfo noCopy{"noCopy", 8, 8};
+    noCopy.destroy = [](void*) {};
+    EXPECT_THROW(world.registerComponent(noCopy), std::invalid_argument);
+    // the ComponentList takes 2 of the 64 signature bits
+    for (int i = 2; i < 64; i++) world.registerComponent(ecs::ComponentInfo{"tag", 0, 1});
+    EXPECT_THROW(world.registerComponent(ecs::ComponentInfo{"tag", 0, 1}), std::length_error);
+}
+
+TEST(V5, testQueryView) {
+    ecs::World<MyECS> world;
+    // three archetypes, the first spanning several chunks
+    for (int i = 0; i < 2500; i++) {
+        world.createEntity<Position, Velocity>(Position{i, 0}, Velocity{1, 2});
+    }
+    for (int i = 0; i < 10; i++) world.createEntity<Position>(Position{i, 0});
+    auto tag = world.registerComponent(ecs::ComponentInfo{"tag", 0, 1});
+    for (int i = 0; i < 100; i++) {
+        world.addComponent(world.createEntity<Velocity, Position>(Velocity{1, 2}, Position{i, 0}),
+                           tag, nullptr);
+    }
+
+    auto view = world.view<Position, const Velocity>();
+    EXPECT_EQ((world.count<Position, Velocity>()), view.size());
+    EXPECT_EQ(2600, view.size());
+    // one segment per chunk: 1024 + 1024 + 452 rows, then the tagged archetype
+    ASSERT_EQ(4, view.segments().size());
+    EXPECT_EQ(1024, view.segments()[0].size());
+
+    // same order as forEach, also when jumping across chunks
+    std::vector<const Position*> order;
+    world.forEach<Position, const Velocity>(
+        [&](Position& pos, const Velocity&) { order.push_back(&pos); });
+    auto it = view.begin();
+    for (size_t i = 0; i < order.size(); i += 37, it += 37) {
+        EXPECT_EQ(order[i], &std::get<0>(*it));
+        EXPECT_EQ(order[i], &std::get<0>(view[i]));
+        EXPECT_EQ(i, size_t(it - view.begin()));
+    }
+    EXPECT_EQ(view.end(), view.begin() + 2600);
+    EXPECT_EQ(view.begin(), view.end() - 2600);
+    EXPECT_EQ(&std::get<0>(view[2599]), &std::get<0>(*--view.end()));
+    EXPECT_EQ(&std::get<0>(view[1023]), &std::get<0>(*--(view.begin() + 1024)));
+    EXPECT_LT(view.begin() + 1024, view.begin() + 1025);
+
+    std::for_each(std::execution::par_unseq, view.begin(), view.end(), [](auto row) {
+        auto [pos, vel] = row;
+        pos.x += vel.dx;
+        pos.y += vel.dy;
+    });
+    int total = std::transform_reduce(std::execution::par, view.begin(), view.end(), 0,
+                                      std::plus<>(), [](auto row) { return std::get<0>(row).y; });
+    EXPECT_EQ(2600 * 2, total);
+
+    // split by chunk instead of by index
+    auto velocities = world.view<const Velocity>();
+    auto segments = velocities.segments();
+    std::atomic<int> sum{0};
+    std::for_each(std::execution::par, segments.begin(), segments.end(), [&](const auto& segment) {
+        int local = 0;
+        for (auto [vel] : segment) local += vel.dy;
+        sum += local;
+    });
+    EXPECT_EQ(2600 * 2, sum.load());
+}
+
+struct Burning {
+    int ticks;
+};
+
+struct SparseECSConfig {
+    using ComponentList = std::tuple<Position, Velocity, Burning>;
+    using SparseComponents = std::tuple<Burning>;
+};
+
+using SparseECS = ecs::ComponentManager<SparseECSConfig>;
+
+TEST(V5, testSparseComponents) {
+    EXPECT_TRUE(SparseECS::IsSparse<Burning>());
+    EXPECT_FALSE(SparseECS::IsSparse<Position>());
+    EXPECT_EQ(0b011, (SparseECS::GetTableMask<Position, Velocity, Burning>()));
+
+    ecs::World<SparseECS> world;
+    std::vector<ecs::EntityId> ids;
+    for (int i = 0; i < 3000; i++) {
+        ids.push_back(world.createEntity<Position, Velocity>(Position{i, 0}, Velocity{1, 0}));
+    }
+    ecs::EntityId lone = world.createEntity<Position, Burning>(Position{-1, 0}, Burning{7});
+    auto positions = world.view<Position>();
+
+    // toggling a sparse component moves no row
+    for (size_t i = 0; i < ids.size(); i += 3) {
+        world.addComponent<Position, Velocity, Burning>(ids[i], Burning{int(i)});
+    }
+    EXPECT_EQ(1001, world.count<Burning>());
+    EXPECT_EQ(1000, (world.count<Velocity, Burning>()));
+    EXPECT_EQ(&std::get<0>(positions[5]), &std::get<0>(world.view<Position>()[5]));
+
+    // driven by the set (smaller than the tables)
+    int visited = 0;
+    world.forEach<Position, const Burning>([&](Position& pos, const Burning& burning) {
+        EXPECT_EQ(pos.x == -1 ? 7 : pos.x, burning.ticks);
+        pos.y = 1;
+        ++visited;
+    });
+    EXPECT_EQ(1001, visited);
+
+    // driven by the tables (smaller than the set)
+    visited = 0;
+    ecs::EntityId small = world.createEntity<Velocity>(Velocity{5, 5});
+    world.addComponent<Velocity, Burning>(small, Burning{1});
+    world.removeComponent<Position>(ids[0]);
+    world.forEach<Velocity, Burning>([&](Velocity&, Burning&) { ++visited; });
+    EXPECT_EQ(1001, visited);
+    visited = 0;
+    world.forEach<const Burning>([&](const Burning&) { ++visited; });
+    EXPECT_EQ(1002, visited);
+
+    world.apply<Position, Burning>(ids[3], [](Position& pos, Burning& burning) {
+        EXPECT_EQ(1, pos.y);
+        burning.ticks = 42;
+    });
+    world.set(ids[6], Burning{43});
+    world.apply<Burning>(ids[3], [](Burning& burning) { EXPECT_EQ(42, burning.ticks); });
+    world.apply<Burning>(ids[6], [](Burning& burning) { EXPECT_EQ(43, burning.ticks); });
+    EXPECT_THROW(world.apply<Burning>(ids[1], [](Burning&) {}), std::runtime_error);
+    EXPECT_THROW(world.set(ids[1], Burning{1}), std::runtime_error);
+
+    // removing it keeps the row, the other components stay
+    world.removeComponent<Burning>(ids[3]);
+    EXPECT_THROW(world.apply<Burning>(ids[3], [](Burning&) {}), std::runtime_error);
+    world.apply<Position, Velocity>(ids[3], [](Position& pos, Velocity&) { EXPECT_EQ(3, pos.x); });
+    EXPECT_EQ(&std::get<0>(positions[5]), &std::get<0>(world.view<Position>()[5]));
+
+    // adding a table component keeps the sparse one
+    world.addComponent<Position, Velocity, Burning>(lone, Velocity{2, 2});
+    world.apply<Velocity, Burning>(lone, [](Velocity& vel, Burning& burning) {
+        EXPECT_EQ(2, vel.dx);
+        EXPECT_EQ(7, burning.ticks);
+    });
+
+    // clones own their sets, destroying drops the sparse components
+    auto copy = world.clone();
+    world.destroyEntity(lone);
+    world.destroyEntity(ids[6]);
+    EXPECT_EQ(999, world.count<Burning>());
+    EXPECT_EQ(1001, copy.count<Burning>());
+    copy.apply<Burning>(lone, [](Burning& burning) { EXPECT_EQ(7, burning.ticks); });
+    ecs::EntityId reborn = world.createEntity<Position>(Position{0, 0});
+    EXPECT_THROW(world.apply<Burning>(reborn, [](Burning&) {}), std::runtime_error);
+}
+
+TEST(V5, testStatsSparseSets) {
+    ecs::World<SparseECS> world;
+    for (int i = 0; i < 3000; i++) world.createEntity<Position>(Position{i, 0});
+    ecs::WorldStats before = world.stats();
+    EXPECT_TRUE(before.sparseSets.empty());
+
+    // ids 0, 2000: two index pages
+    world.addComponent<Position, Burning>(0, Burning{1});
+    world.addComponent<Position, Burning>(2000, Burning{2});
+    ecs::WorldStats stats = world.stats();
+    ASSERT_EQ(1u, stats.sparseSets.size());
+    const ecs::SparseSetStats& burning = stats.sparseSets[0];
+    EXPECT_EQ(SparseECS::GetComponentID<Burning>(), burning.component);
+    EXPECT_EQ(sizeof(Burning), burning.elementSize);
+    EXPECT_EQ(2u, burning.members);
+    EXPECT_EQ(2 * (sizeof(Burning) + sizeof(ecs::EntityId)), burning.bytesUsed);
+    EXPECT_GE(burning.valueBytes, 2 * sizeof(Burning));
+    EXPECT_GE(burning.idBytes, 2 * sizeof(ecs::EntityId));
+    EXPECT_EQ(2u, burning.indexPages);
+    EXPECT_GT(burning.indexBytes, 2 * 1024 * sizeof(uint32_t));
+
+    // the tables are unchanged, the set adds to the totals
+    EXPECT_EQ(before.bytesUsed() + burning.bytesUsed, stats.bytesUsed());
+    EXPECT_EQ(before.bytesReserved() + burning.bytesReserved(), stats.bytesReserved());
+    EXPECT_EQ(before.bytesTotal() + burning.bytesReserved() + burning.indexBytes,
+              stats.bytesTotal());
+    EXPECT_NE(std::string::npos, stats.toTable().find("sparse"));
+    EXPECT_NE(std::string::npos, stats.toJson().find("\"sparseSets\":[{\"component\":2,"));
+
+    // the last member of a page releases it
+    world.removeComponent<Burning>(2000);
+    EXPECT_EQ(1u, world.stats().sparseSets[0].indexPages);
+}
+
+#if defined(ECS_PROFILING)
+
+TEST(V5, testProfilerSparseZone) {
+    ecs::World<SparseECS> world;
+    for (int i = 0; i < 100; i++) {
+        ecs::EntityId id = world.createEntity<Position>(Position{i, 0});
+        if (i % 10 == 0) world.addComponent<Position, Burning>(id, Burning{i});
+    }
+    auto& profiler = ecs::profiler::Profiler::instance();
+    profiler.clear();
+    // driven by the 10 members of the set, all in one archetype
+    world.forEach<Position, const Burning>([](Position&, const Burning&) {});
+    auto events = profiler.collect();
+    ASSERT_EQ(1u, events.size());
+    EXPECT_EQ(1u, events[0].archetypes);
+    EXPECT_EQ(10u, events[0].rows);
+}
+
+#endif
+
+TEST(V5, testShardedWorldMigrateSparse) {
+    constexpr size_t shards = 2;
+    ecs::ShardedWorld<SparseECS> world(shards);
+    std::vector<ecs::EntityId> ids;
+    for (int i = 0; i < 2000; i++) {
+        ids.push_back(world.createEntity<Position>(0, Position{i, 0}));
+        if (i % 4 == 0) world.shard(0).addComponent<Position, Burning>(ids.back(), Burning{i});
+    }
+
+    // sparse components travel with their entities
+    auto shardOf = [](const Position& pos) { return static_cast<size_t>(pos.x / 1000) % shards; };
+    EXPECT_EQ(1000, world.migrate<Position>(shardOf));
+    EXPECT_EQ(250, world.shard(0).count<Burning>());
+    EXPECT_EQ(250, world.shard(1).count<Burning>());
+    for (size_t s = 0; s < shards; s++) {
+        world.shard(s).forEach<const Position, const Burning>(
+            [&](const Position& pos, const Burning& burning) {
+                EXPECT_EQ(s, shardOf(pos));
+                EXPECT_EQ(pos.x, burning.ticks);
+            });
+    }
+    for (int i = 0; i < 2000; i++) {
+        if (i % 4 != 0) continue;
+        world.apply<const Burning>(ids[i], [&](const Burning& burning) {
+            EXPECT_EQ(i, burning.ticks);
+        });
+    }
+}
+
+TEST(V5, testChunkMemory) {
+    ecs::setChunkMemory(ecs::ChunkMemory::hugePages);
+    EXPECT_EQ(ecs::ChunkMemory::hugePages, ecs::chunkMemory());
+    {
+        ecs::World<MyECS> world;
+        auto tag = world.registerComponent(ecs::ComponentInfo::of<int>("int"));
+        std::vector<ecs::EntityId> ids;
+        for (int i = 0; i < 5000; i++) {
+            ids.push_back(world.createEntity<Position, Velocity>(Position{i, 0}, Velocity{1, 1}));
+            int value = i;
+            world.addComponent(ids.back(), tag, &value);
+        }
+        for (int i = 0; i < 5000; i += 2) world.destroyEntity(ids[i]);
+#if defined(__linux__)
+        // slabs with or without huge pages, depending on the system
+        ecs::ChunkMemoryStats stats = ecs::chunkMemoryStats();
+        EXPECT_GT(stats.slabs, 0);
+        EXPECT_GE(stats.bytesMapped, stats.slabs * (size_t{2} << 20));
+
+        // blocks beyond a slab get slabs of their own, reused once freed
+        ecs::detail::ChunkAllocator<std::byte> allocator;
+        size_t large = size_t{3} << 20;
+        std::byte* block = allocator.allocate(large);
+        block[large - 1] = std::byte{1};
+        EXPECT_EQ(stats.largeMappings + 1, ecs::chunkMemoryStats().largeMappings);
+        allocator.deallocate(block, large);
+        EXPECT_EQ(stats.largeMappings, ecs::chunkMemoryStats().largeMappings);
+        std::byte* again = allocator.allocate(large);
+        EXPECT_EQ(block, again);
+        allocator.deallocate(again, large);
+#endif
+
+        // each of two workers moves the chunks starting in its half
+        size_t total = world.count<Position>();
+        const Position* before = &std::get<0>(world.view<Position>()[0]);
+        std::thread worker([&] { world.relocateChunks<Position>(total / 2, total); });
+        world.relocateChunks<Position>(0, total / 2);
+        worker.join();
+        EXPECT_NE(before, &std::get<0>(world.view<Position>()[0]));
+
+        ecs::setChunkMemory(ecs::ChunkMemory::heap);
+        for (int i = 1; i < 5000; i += 2) {
+            world.apply<Position, Velocity>(ids[i], [&](Position& pos, Velocity& vel) {
+                EXPECT_EQ(i, pos.x);
+                EXPECT_EQ(1, vel.dy);
+            });
+            EXPECT_EQ(i, *static_cast<int*>(world.get(ids[i], tag)));
+        }
+    }
+    ecs::setChunkMemory(ecs::ChunkMemory::heap);
+}
@@ -1,5 +1,11 @@
 #pragma once
+#include <array>
+#include <cstddef>
 #include <functional>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
 
 namespace ecs {
 
@@ -13,42 +19,94 @@ template <typename T>
 struct ComponentStorage {
     std::vector<T> components;  // Komponente[n]
     std::vector<int> dense;     // entityIds[i] gehört zu components[i]
-    std::vector<int> sparse;    // entityId → index in dense/comp, oder -1
 
-    ComponentStorage() {
-        sparse.resize(1000, -1);  // maxEntityCount z. B. 100k
-    }
+    // Set by the Group owning this storage: called after an entity got the component and before
+    // it loses it.
+    std::function<void(int)> onAdd;
+    std::function<void(int)> onRemove;
 
     void add(int entityId, const T& component) {
-        if (sparse[entityId] != -1) return;  // schon vorhanden
-        sparse[entityId] = dense.size();
+        if (index(entityId) != -1) return;  // schon vorhanden
+        setIndex(entityId, dense.size());
         dense.push_back(entityId);
         components.push_back(component);
+        if (onAdd) onAdd(entityId);
     }
 
     void remove(int entityId) {
-        int index = sparse[entityId];
-        if (index == -1) return;
+        if (index(entityId) == -1) return;
+        if (onRemove) onRemove(entityId);  // may move the entity
+        int i = index(entityId);
 
         int last = dense.size() - 1;
 
-        std::swap(dense[index], dense[last]);
-        std::swap(components[index], components[last]);
+        std::swap(dense[i], dense[last]);
+        std::swap(components[i], components[last]);
 
-        sparse[dense[index]] = index;
-        sparse[entityId] = -1;
+        setIndex(dense[i], i);
+        setIndex(entityId, -1);
 
         dense.pop_back();
         components.pop_back();
     }
 
     T* get(int entityId) {
-        int index = sparse[entityId];
-        return (index == -1) ? nullptr : &components[index];
+        int i = index(entityId);
+        return (i == -1) ? nullptr : &components[i];
+    }
+
+    // Index of the entity in dense/components, or -1.
+    int index(int entityId) const {
+        size_t p = static_cast<size_t>(entityId) / pageSize;
+        if (p >= pages.size() || !pages[p]) return -1;
+        return pages[p]->slots[static_cast<size_t>(entityId) % pageSize];
+    }
+
+    // Swaps the entries at dense positions a and b.
+    void swapEntries(size_t a, size_t b) {
+        if (a == b) return;
+        std::swap(dense[a], dense[b]);
+        std::swap(components[a], components[b]);
+        setIndex(dense[a], a);
+        setIndex(dense[b], b);
+    }
+
+    // Bytes of the sparse index: the page table and the allocated pages.
+    size_t indexBytes() const {
+        size_t bytes = pages.capacity() * sizeof(pages[0]);
+        for (const auto& page : pages) {
+            if (page) bytes += sizeof(Page);
+        }
+        return bytes;
     }
 
     std::vector<T>& getAllComponents() { return components; }
     std::vector<int>& getAllEntities() { return dense; }
+
+   private:
+    // The sparse index (entityId → index in dense/comp, or -1) in pages of pageSize ids. A page
+    // is allocated when its first entity gets the component and released when its last one
+    // loses it, so a storage with few members stays small however large the ids grow.
+    static constexpr size_t pageSize = 4096;
+
+    struct Page {
+        Page() { slots.fill(-1); }
+        std::array<int, pageSize> slots;
+        size_t count = 0;  // slots != -1
+    };
+
+    std::vector<std::unique_ptr<Page>> pages;
+
+    void setIndex(int entityId, int i) {
+        size_t p = static_cast<size_t>(entityId) / pageSize;
+        if (p >= pages.size()) pages.resize(p + 1);
+        if (!pages[p]) pages[p] = std::make_unique<Page>();
+        int& slot = pages[p]->slots[static_cast<size_t>(entityId) % pageSize];
+        if (slot == -1 && i != -1) pages[p]->count++;
+        if (slot != -1 && i == -1) pages[p]->count--;
+        slot = i;
+        if (pages[p]->count == 0) pages[p].reset();
+    }
 };
 
 template <typename T>
@@ -57,6 +115,65 @@ ComponentStorage<T>& getStorage() {
     return storage;
 }
 
+// Owning group: the entities that have all Owned components are kept packed at the front of every
+// owned storage, in the same order, so position i of each storage belongs to the same entity.
+// Iterating them is a parallel loop over the component arrays without sparse lookups. add and
+// remove keep the front packed by swapping the entity into or out of it. A storage can be owned
+// by one group at a time, a second group throws std::logic_error; the group releases its storages
+// when it is destroyed.
+template <typename... Owned>
+class Group {
+   public:
+    Group() {
+        if ((getStorage<Owned>().onAdd || ...) || (getStorage<Owned>().onRemove || ...)) {
+            throw std::logic_error("A storage is already owned by a group.");
+        }
+        ((getStorage<Owned>().onAdd = [this](int entityId) { enter(entityId); }), ...);
+        ((getStorage<Owned>().onRemove = [this](int entityId) { leave(entityId); }), ...);
+        // Entering swaps the entity to a position before i, whose entity was already visited
+        auto& entities = getStorage<Lead>().dense;
+        for (size_t i = 0; i < entities.size(); i++) enter(entities[i]);
+    }
+    ~Group() {
+        ((getStorage<Owned>().onAdd = nullptr), ...);
+        ((getStorage<Owned>().onRemove = nullptr), ...);
+    }
+
+    Group(const Group&) = delete;
+    Group& operator=(const Group&) = delete;
+
+    size_t size() const { return length; }
+
+    // Calls func(Owned&...) for every entity of the group.
+    template <typename Func>
+    void each(Func func) {
+        auto arrays = std::make_tuple(getStorage<Owned>().components.data()...);
+        for (size_t i = 0; i < length; i++) func(std::get<Owned*>(arrays)[i]...);
+    }
+
+   private:
+    using Lead = std::tuple_element_t<0, std::tuple<Owned...>>;
+
+    size_t length = 0;
+
+    bool isMember(int entityId) {
+        int index = getStorage<Lead>().index(entityId);
+        return index != -1 && static_cast<size_t>(index) < length;
+    }
+
+    void enter(int entityId) {
+        if (isMember(entityId) || !(getStorage<Owned>().get(entityId) && ...)) return;
+        (getStorage<Owned>().swapEntries(getStorage<Owned>().index(entityId), length), ...);
+        length++;
+    }
+
+    void leave(int entityId) {
+        if (!isMember(entityId)) return;
+        length--;
+        (getStorage<Owned>().swapEntries(getStorage<Owned>().index(entityId), length), ...);
+    }
+};
+
 template <typename T>
 void addComponent(Entity e, const T& comp) {
     getStorage<T>().add(e.id, comp);
@@ -82,4 +199,4 @@ void tick() {
     for (auto& sys : systems) sys();
 }
 
-}  // namespace ecs
\ No newline at end of file
+}  // namespace ecs
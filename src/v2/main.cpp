@@ -32,21 +32,14 @@ void mainEcs() {
         ecs::addComponent(e, Coordinates{getRandom(), getRandom()});
         ecs::addComponent(e, Velocity{getRandom(), getRandom()});
     }
+    // entities with Coordinates and Velocity, packed at the front of both storages
+    ecs::Group<Coordinates, Velocity> movers;
     // add position system
-    ecs::addSystem([]() {
-        auto& coordStorage = ecs::getStorage<Coordinates>();
-        auto& velStorage = ecs::getStorage<Velocity>();
-
-        auto& coordList = coordStorage.getAllComponents();
-        auto& entities = coordStorage.getAllEntities();
-
-        for (size_t i = 0; i < coordList.size(); i++) {
-            int entityId = entities[i];
-            auto* vel = velStorage.get(entityId);
-            if (!vel) continue;
-            coordList[i].x += vel->xVel;
-            coordList[i].y += vel->yVel;
-        }
+    ecs::addSystem([&movers]() {
+        movers.each([](Coordinates& coord, Velocity& vel) {
+            coord.x += vel.xVel;
+            coord.y += vel.yVel;
+        });
     });
     // tick n times and mess time
     auto startTime = std::chrono::high_resolution_clock::now();
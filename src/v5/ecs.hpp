@@ -1,14 +1,51 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <new>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <string>
 #include <tuple>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "memory.hpp"
+#include "profiler.hpp"
+#include "stats.hpp"
+
+// Hint to load the cache line of address, used by batched random access.
+#if defined(__GNUC__) || defined(__clang__)
+#define ECS_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define ECS_PREFETCH(address) ((void)(address))
+#endif
+
 namespace ecs {
 
 // Define types for clearer parameters
 using EntityId = unsigned int;
 
+// Component lifecycle events an observer reacts to, see World::observe.
+enum class ObserverEvent {
+    // The entity starts to have all components of the observer.
+    OnAdd,
+    // The entity stops having all components of the observer.
+    OnRemove,
+    // A component of the observer gets a value on an entity having all of them.
+    OnSet,
+};
+
 // ComponentManager template.
 // Accepts a user-defined configuration that provides a compile-time ComponentList.
 template <typename UserConfig>
@@ -53,6 +90,94 @@ struct ComponentManager {
     // E.g.: ComponentType<1> gives you the second component type in ComponentList.
     template <std::size_t ID>
     using ComponentType = std::tuple_element_t<ID, ComponentList>;
+
+    // Optional user-defined subset of ComponentList stored in sparse sets instead of archetype
+    // columns, for components that are added and removed often (status effects, tags).
+    // Example: using SparseComponents = std::tuple<Burning, Stunned>;
+    template <typename Config>
+    static auto sparseComponents() {
+        if constexpr (requires { typename Config::SparseComponents; }) {
+            return std::type_identity<typename Config::SparseComponents>{};
+        } else {
+            return std::type_identity<std::tuple<>>{};
+        }
+    }
+    using SparseComponentList = typename decltype(sparseComponents<UserConfig>())::type;
+
+    template <typename T, typename Tuple>
+    struct InTuple;
+
+    template <typename T, typename... Types>
+    struct InTuple<T, std::tuple<Types...>>
+        : std::bool_constant<(std::is_same_v<T, Types> || ...)> {};
+
+    template <typename Tuple>
+    struct InComponentList;
+
+    template <typename... Types>
+    struct InComponentList<std::tuple<Types...>>
+        : std::bool_constant<(InTuple<Types, ComponentList>::value && ...)> {};
+
+    static_assert(InComponentList<SparseComponentList>::value,
+                  "SparseComponents must be part of the ComponentList");
+
+    // Whether T is stored in a sparse set.
+    template <typename T>
+    static constexpr bool IsSparse() {
+        return InTuple<T, SparseComponentList>::value;
+    }
+
+    // Signature bits of the components stored in archetype columns, sparse ones have none.
+    template <typename... Components>
+    static constexpr std::size_t GetTableMask() {
+        return (std::size_t{0} | ... |
+                (IsSparse<std::decay_t<Components>>()
+                     ? 0
+                     : GetComponentMask<std::decay_t<Components>>()));
+    }
+
+    template <typename... Components>
+    static constexpr bool HasSparse() {
+        return (IsSparse<std::decay_t<Components>>() || ...);
+    }
+};
+
+// Layout of a component type defined at runtime, e.g. by a modding or scripting layer, see
+// World::registerComponent. Null functions mean the values are plain bytes: they are copied with
+// memcpy and not destroyed.
+struct ComponentInfo {
+    std::string name;
+    size_t size = 0;
+    size_t alignment = alignof(std::max_align_t);
+    // Constructs a copy of src at dst.
+    void (*copy)(void* dst, const void* src) = nullptr;
+    // Constructs dst from src, which stays valid and is destroyed later.
+    void (*move)(void* dst, void* src) = nullptr;
+    void (*destroy)(void* value) = nullptr;
+
+    // The layout of a C++ type, e.g. for the components of a native plugin.
+    template <typename T>
+    static ComponentInfo of(std::string name) {
+        ComponentInfo info{std::move(name), sizeof(T), alignof(T)};
+        if constexpr (!std::is_trivially_copyable_v<T>) {
+            info.copy = [](void* dst, const void* src) {
+                new (dst) T(*static_cast<const T*>(src));
+            };
+            info.move = [](void* dst, void* src) { new (dst) T(std::move(*static_cast<T*>(src))); };
+        }
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            info.destroy = [](void* value) { static_cast<T*>(value)->~T(); };
+        }
+        return info;
+    }
+};
+
+// A component type registered at runtime, returned by World::registerComponent. Valid in that
+// world and its clones.
+struct DynamicComponent {
+    size_t id = 0;
+
+    size_t mask() const { return size_t{1} << id; }
 };
 
 namespace detail {
@@ -66,27 +191,239 @@ inline bool matchArchetypeSignatures(const ArchetypeSignature sig, const Archety
     return (sig & query) == query;
 }
 
+// The last type of a non-empty pack.
+template <typename... Types>
+using LastType = std::tuple_element_t<sizeof...(Types) - 1, std::tuple<Types...>>;
+
+// Number of rows stored in one chunk of a column.
+// Chunks are the unit of sharing between cloned worlds (see World::clone).
+inline constexpr size_t chunkCapacity = 1024;
+
+// A column of values, split into chunks of chunkCapacity rows.
+// Chunks are reference counted, so copying a column only copies the chunk pointers. A shared
+// chunk is copied on its first write (copy-on-write), reads always use the shared data.
+template <typename T>
+struct Column {
+    using Chunk = std::vector<T, ChunkAllocator<T>>;
+    std::vector<std::shared_ptr<Chunk>> chunks;
+    size_t count = 0;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Returns true if the rows of the last chunk moved in memory, because it grew.
+    template <typename U>
+    bool push_back(U&& value) {
+        if (count % chunkCapacity == 0) chunks.push_back(std::make_shared<Chunk>());
+        Chunk& last = mutableChunk(chunks.size() - 1);
+        bool grown = !last.empty() && last.size() == last.capacity();
+        last.push_back(std::forward<U>(value));
+        ++count;
+        return grown;
+    }
+
+    void pop_back() {
+        Chunk& last = mutableChunk(chunks.size() - 1);
+        last.pop_back();
+        if (last.empty()) chunks.pop_back();
+        --count;
+    }
+
+    // Write access, detaches the chunk of the row if it is shared.
+    T& operator[](size_t index) {
+        return mutableChunk(index / chunkCapacity)[index % chunkCapacity];
+    }
+
+    // Read access, never copies.
+    const T& operator[](size_t index) const {
+        return (*chunks[index / chunkCapacity])[index % chunkCapacity];
+    }
+
+    const Chunk& chunk(size_t c) const { return *chunks[c]; }
+
+    // Whether chunk c is still shared with a cloned column.
+    bool shared(size_t c) const { return chunks[c].use_count() > 1; }
+
+    // Appends all rows of other and leaves it empty. If this column ends on a chunk boundary the
+    // chunks of other are taken over as they are, otherwise the rows are copied chunk by chunk.
+    void append(Column&& other) {
+        if (count % chunkCapacity == 0) {
+            chunks.insert(chunks.end(), std::make_move_iterator(other.chunks.begin()),
+                          std::make_move_iterator(other.chunks.end()));
+            count += other.count;
+        } else {
+            for (auto& source : other.chunks) {
+                // a chunk still shared with a cloned world is copied, otherwise moved
+                if (source.use_count() == 1) {
+                    appendRange(std::make_move_iterator(source->begin()), source->size());
+                } else {
+                    appendRange(source->cbegin(), source->size());
+                }
+            }
+        }
+        other.chunks.clear();
+        other.count = 0;
+    }
+
+    // Appends the rows [first, first + n) to out.
+    void copyRange(size_t first, size_t n, std::vector<T>& out) const {
+        while (n > 0) {
+            const Chunk& rows = chunk(first / chunkCapacity);
+            size_t offset = first % chunkCapacity;
+            size_t k = std::min(rows.size() - offset, n);
+            out.insert(out.end(), rows.begin() + offset, rows.begin() + offset + k);
+            first += k;
+            n -= k;
+        }
+    }
+
+    // Appends n copies of value.
+    void appendCopies(const T& value, size_t n) {
+        while (n > 0) {
+            if (count % chunkCapacity == 0) chunks.push_back(std::make_shared<Chunk>());
+            Chunk& last = mutableChunk(chunks.size() - 1);
+            size_t rows = std::min(chunkCapacity - count % chunkCapacity, n);
+            last.insert(last.end(), rows, value);
+            count += rows;
+            n -= rows;
+        }
+    }
+
+    // Reorders the rows [first, first + order.size()), row first + i gets the old row
+    // first + order[i].
+    void permute(size_t first, const std::vector<size_t>& order) {
+        std::vector<T> values;
+        values.reserve(order.size());
+        for (size_t i : order) values.push_back(std::move((*this)[first + i]));
+        for (size_t i = 0; i < order.size(); ++i) (*this)[first + i] = std::move(values[i]);
+    }
+
+    // Releases unused capacity of the chunk table and the last chunk.
+    // Only the last chunk can be partly filled, since rows are removed by swapping in the last row.
+    // Returns true if the rows of the last chunk moved in memory.
+    bool shrinkToFit() {
+        chunks.shrink_to_fit();
+        if (chunks.empty() || chunks.back().use_count() != 1) return false;
+        Chunk& last = *chunks.back();
+        if (last.size() == last.capacity()) return false;
+        last.shrink_to_fit();
+        return true;
+    }
+
+    ColumnStats stats() const {
+        ColumnStats result;
+        result.elementSize = sizeof(T);
+        result.rows = count;
+        result.chunks = chunks.size();
+        result.bytesUsed = count * sizeof(T);
+        result.bytesOverhead =
+            chunks.capacity() * sizeof(std::shared_ptr<Chunk>) + chunks.size() * sizeof(Chunk);
+        for (const auto& chunk : chunks) {
+            result.bytesReserved += chunk->capacity() * sizeof(T);
+            if (chunk.use_count() > 1) {
+                ++result.sharedChunks;
+                result.bytesShared += chunk->capacity() * sizeof(T);
+            }
+        }
+        return result;
+    }
+
+    // Appends the n rows starting at it, filling up the last chunk first.
+    template <typename It>
+    void appendRange(It it, size_t n) {
+        while (n > 0) {
+            if (count % chunkCapacity == 0) chunks.push_back(std::make_shared<Chunk>());
+            Chunk& last = mutableChunk(chunks.size() - 1);
+            size_t rows = std::min(chunkCapacity - count % chunkCapacity, n);
+            last.insert(last.end(), it, it + rows);
+            it += rows;
+            count += rows;
+            n -= rows;
+        }
+    }
+
+    // Moves chunk c into memory allocated and first written by the calling thread, see
+    // World::relocateChunks. A chunk shared with a cloned world stays where it is.
+    void relocate(size_t c) {
+        std::shared_ptr<Chunk>& chunk = chunks[c];
+        if (chunk.use_count() > 1) return;
+        auto copy = std::make_shared<Chunk>();
+        copy->reserve(chunk->capacity());
+        copy->assign(std::make_move_iterator(chunk->begin()),
+                     std::make_move_iterator(chunk->end()));
+        chunk = std::move(copy);
+    }
+
+    // Returns chunk c for writing. If another column still shares it, it is copied first.
+    Chunk& mutableChunk(size_t c) {
+        std::shared_ptr<Chunk>& chunk = chunks[c];
+        if (chunk.use_count() > 1) {
+            auto copy = std::make_shared<Chunk>();
+            copy->reserve(chunk->capacity());
+            copy->assign(chunk->begin(), chunk->end());
+            chunk = std::move(copy);
+        }
+        return *chunk;
+    }
+};
+
+// A counter that several threads may increment at once, copied and moved by value with the
+// object that holds it.
+class AtomicCounter {
+   public:
+    AtomicCounter() = default;
+    AtomicCounter(const AtomicCounter& other) : value(other.load()) {}
+    AtomicCounter& operator=(const AtomicCounter& other) {
+        value.store(other.load(), std::memory_order_relaxed);
+        return *this;
+    }
+
+    uint64_t load() const { return value.load(std::memory_order_relaxed); }
+    void increment() { value.fetch_add(1, std::memory_order_relaxed); }
+
+   private:
+    std::atomic<uint64_t> value{0};
+};
+
 // Base interface for component arrays, allowing polymorphic behavior.
 struct IComponentArray {
     virtual ~IComponentArray() = default;
     virtual void copyElementFrom(IComponentArray* source, size_t sourceIndex) = 0;
     virtual void moveElement(size_t fromIndex, size_t toIndex) = 0;
     virtual void removeLast() = 0;
+    // Returns a copy sharing all chunks with this array.
+    virtual std::unique_ptr<IComponentArray> clone() const = 0;
+    virtual ColumnStats stats() const = 0;
+    // Returns true if rows moved in memory.
+    virtual bool shrinkToFit() = 0;
+    virtual void permute(size_t first, const std::vector<size_t>& order) = 0;
+    // Appends all rows of source, an array of the same type, and leaves it empty.
+    virtual void appendFrom(IComponentArray* source) = 0;
+    // Returns an empty array of the same type.
+    virtual std::unique_ptr<IComponentArray> createEmpty() const = 0;
+    // Moves chunk c into memory of the calling thread, see Column<T>::relocate.
+    virtual void relocate(size_t c) = 0;
 };
 
 // A generic component array that stores the actual components (data).
 template <typename T>
 struct ComponentArray : IComponentArray {
-    std::vector<T> data;
+    Column<T> data;
 
-    void push_back(const T& value) { data.push_back(value); }
+    // Returns true if rows moved in memory, see Column::push_back.
+    template <typename U>
+    bool push_back(U&& value) {
+        return data.push_back(std::forward<U>(value));
+    }
 
     T& get(size_t index) { return data[index]; }
 
-    std::vector<T>& getVector() { return data; }
+    const T& get(size_t index) const { return std::as_const(data)[index]; }
+
+    Column<T>& getColumn() { return data; }
 
     void copyElementFrom(IComponentArray* source, size_t sourceIndex) override {
-        auto* src = static_cast<ComponentArray<T>*>(source);
+        const auto* src = static_cast<const ComponentArray<T>*>(source);
         data.push_back(src->get(sourceIndex));
     }
 
@@ -95,12 +432,354 @@ struct ComponentArray : IComponentArray {
     }
 
     void removeLast() override { data.pop_back(); }
+
+    std::unique_ptr<IComponentArray> clone() const override {
+        return std::make_unique<ComponentArray<T>>(*this);
+    }
+
+    ColumnStats stats() const override { return data.stats(); }
+
+    bool shrinkToFit() override { return data.shrinkToFit(); }
+
+    void permute(size_t first, const std::vector<size_t>& order) override {
+        data.permute(first, order);
+    }
+
+    void appendFrom(IComponentArray* source) override {
+        data.append(std::move(static_cast<ComponentArray<T>*>(source)->data));
+    }
+
+    std::unique_ptr<IComponentArray> createEmpty() const override {
+        return std::make_unique<ComponentArray<T>>();
+    }
+
+    void relocate(size_t c) override { data.relocate(c); }
+};
+
+// Returns the rows of chunk c of the array.
+// A const qualified Access type only reads, so a chunk shared with a cloned world stays shared.
+template <typename Access, typename T>
+Access* chunkData(ComponentArray<T>* array, size_t c) {
+    if constexpr (std::is_const_v<Access>) {
+        return array->data.chunk(c).data();
+    } else {
+        return array->data.mutableChunk(c).data();
+    }
+}
+
+// Returns the component at index, with the same const rules as chunkData.
+template <typename Access, typename T>
+Access& element(ComponentArray<T>* array, size_t index) {
+    if constexpr (std::is_const_v<Access>) {
+        return std::as_const(*array).get(index);
+    } else {
+        return array->get(index);
+    }
+}
+
+// Rows of a runtime component type, the type-erased counterpart of Column<T>::Chunk. Grows like a
+// vector, values are copied, moved and destroyed through the ComponentInfo.
+class ByteChunk {
+   public:
+    explicit ByteChunk(std::shared_ptr<const ComponentInfo> info) : info(std::move(info)) {}
+    ByteChunk(const ByteChunk& other) : info(other.info) {
+        reserve(other.capacity);
+        for (; rows < other.rows; ++rows) copyConstruct(at(rows), other.at(rows));
+    }
+    // Moves the values into new memory of the same capacity, leaving other empty.
+    ByteChunk(ByteChunk&& other) : info(other.info) {
+        reserve(other.capacity);
+        for (; rows < other.rows; ++rows) moveConstruct(at(rows), other.at(rows));
+        while (other.rows > 0) other.popBack();
+    }
+    ByteChunk& operator=(const ByteChunk&) = delete;
+    ~ByteChunk() {
+        while (rows > 0) popBack();
+        deallocate(bytes);
+    }
+
+    size_t size() const { return rows; }
+    bool empty() const { return rows == 0; }
+    size_t reserved() const { return capacity; }
+
+    void* at(size_t i) { return bytes + i * info->size; }
+    const void* at(size_t i) const { return bytes + i * info->size; }
+    std::byte* data() { return bytes; }
+
+    void pushCopy(const void* value) {
+        grow();
+        copyConstruct(at(rows), value);
+        ++rows;
+    }
+
+    // Leaves value moved from.
+    void pushMove(void* value) {
+        grow();
+        moveConstruct(at(rows), value);
+        ++rows;
+    }
+
+    void popBack() {
+        --rows;
+        if (info->destroy) info->destroy(at(rows));
+    }
+
+    // Replaces row i by value, leaving value moved from.
+    void assignMove(size_t i, void* value) {
+        if (info->destroy) info->destroy(at(i));
+        moveConstruct(at(i), value);
+    }
+
+    // Replaces row i by a copy of value.
+    void assignCopy(size_t i, const void* value) {
+        if (info->destroy) info->destroy(at(i));
+        copyConstruct(at(i), value);
+    }
+
+    void reserve(size_t n) {
+        if (n <= capacity) return;
+        reallocate(n);
+    }
+
+    // Returns true if the rows moved in memory.
+    bool shrinkToFit() {
+        if (rows == capacity) return false;
+        reallocate(rows);
+        return true;
+    }
+
+   private:
+    std::shared_ptr<const ComponentInfo> info;
+    std::byte* bytes = nullptr;
+    size_t rows = 0;
+    size_t capacity = 0;
+
+    void copyConstruct(void* dst, const void* src) const {
+        if (info->copy) {
+            info->copy(dst, src);
+        } else if (src) {
+            // tags (size 0) may be added without a value
+            std::memcpy(dst, src, info->size);
+        }
+    }
+
+    void moveConstruct(void* dst, void* src) const {
+        if (info->move) {
+            info->move(dst, src);
+        } else {
+            std::memcpy(dst, src, info->size);
+        }
+    }
+
+    void grow() {
+        if (rows < capacity) return;
+        reallocate(std::min(std::max<size_t>(2 * capacity, 8), chunkCapacity));
+    }
+
+    void reallocate(size_t n) {
+        auto* target = static_cast<std::byte*>(
+            ChunkMemoryResource::instance().allocate(n * info->size, info->alignment));
+        for (size_t i = 0; i < rows; ++i) {
+            moveConstruct(target + i * info->size, at(i));
+            if (info->destroy) info->destroy(at(i));
+        }
+        deallocate(bytes);
+        bytes = target;
+        capacity = n;
+    }
+
+    void deallocate(std::byte* memory) const {
+        if (memory) {
+            ChunkMemoryResource::instance().deallocate(memory, capacity * info->size,
+                                                       info->alignment);
+        }
+    }
+};
+
+// Column of a runtime component type, chunked and shared copy-on-write like Column<T>.
+struct ByteColumn {
+    std::shared_ptr<const ComponentInfo> info;
+    std::vector<std::shared_ptr<ByteChunk>> chunks;
+    size_t count = 0;
+
+    explicit ByteColumn(std::shared_ptr<const ComponentInfo> info) : info(std::move(info)) {}
+
+    size_t size() const { return count; }
+
+    // Write access, detaches the chunk of the row if it is shared.
+    void* operator[](size_t index) {
+        return mutableChunk(index / chunkCapacity).at(index % chunkCapacity);
+    }
+
+    // Read access, never copies.
+    const void* operator[](size_t index) const {
+        return std::as_const(*chunks[index / chunkCapacity]).at(index % chunkCapacity);
+    }
+
+    void pushCopy(const void* value) {
+        lastChunk().pushCopy(value);
+        ++count;
+    }
+
+    void pushMove(void* value) {
+        lastChunk().pushMove(value);
+        ++count;
+    }
+
+    void popBack() {
+        ByteChunk& last = mutableChunk(chunks.size() - 1);
+        last.popBack();
+        if (last.empty()) chunks.pop_back();
+        --count;
+    }
+
+    // Appends all rows of other and leaves it empty, taking its chunks over if this column ends
+    // on a chunk boundary like Column<T>::append.
+    void append(ByteColumn&& other) {
+        if (count % chunkCapacity == 0) {
+            chunks.insert(chunks.end(), std::make_move_iterator(other.chunks.begin()),
+                          std::make_move_iterator(other.chunks.end()));
+            count += other.count;
+        } else {
+            for (auto& source : other.chunks) {
+                for (size_t i = 0; i < source->size(); ++i) {
+                    if (source.use_count() == 1) {
+                        pushMove(source->at(i));
+                    } else {
+                        pushCopy(std::as_const(*source).at(i));
+                    }
+                }
+            }
+        }
+        other.chunks.clear();
+        other.count = 0;
+    }
+
+    // Same as Column<T>::permute.
+    void permute(size_t first, const std::vector<size_t>& order) {
+        ByteChunk values(info);
+        values.reserve(order.size());
+        for (size_t i : order) values.pushMove((*this)[first + i]);
+        for (size_t i = 0; i < order.size(); ++i) {
+            size_t row = first + i;
+            mutableChunk(row / chunkCapacity).assignMove(row % chunkCapacity, values.at(i));
+        }
+    }
+
+    // Returns true if the rows of the last chunk moved in memory, like Column::shrinkToFit.
+    bool shrinkToFit() {
+        chunks.shrink_to_fit();
+        return !chunks.empty() && chunks.back().use_count() == 1 && chunks.back()->shrinkToFit();
+    }
+
+    ColumnStats stats() const {
+        ColumnStats result;
+        result.elementSize = info->size;
+        result.rows = count;
+        result.chunks = chunks.size();
+        result.bytesUsed = count * info->size;
+        result.bytesOverhead = chunks.capacity() * sizeof(std::shared_ptr<ByteChunk>) +
+                               chunks.size() * sizeof(ByteChunk);
+        for (const auto& chunk : chunks) {
+            result.bytesReserved += chunk->reserved() * info->size;
+            if (chunk.use_count() > 1) {
+                ++result.sharedChunks;
+                result.bytesShared += chunk->reserved() * info->size;
+            }
+        }
+        return result;
+    }
+
+    // Same as Column<T>::relocate.
+    void relocate(size_t c) {
+        std::shared_ptr<ByteChunk>& chunk = chunks[c];
+        if (chunk.use_count() > 1) return;
+        chunk = std::make_shared<ByteChunk>(std::move(*chunk));
+    }
+
+    // Returns chunk c for writing. If another column still shares it, it is copied first.
+    ByteChunk& mutableChunk(size_t c) {
+        std::shared_ptr<ByteChunk>& chunk = chunks[c];
+        if (chunk.use_count() > 1) chunk = std::make_shared<ByteChunk>(*chunk);
+        return *chunk;
+    }
+
+   private:
+    ByteChunk& lastChunk() {
+        if (count % chunkCapacity == 0) chunks.push_back(std::make_shared<ByteChunk>(info));
+        return mutableChunk(chunks.size() - 1);
+    }
+};
+
+// Component array of a runtime component type.
+struct ByteArray : IComponentArray {
+    ByteColumn data;
+
+    explicit ByteArray(std::shared_ptr<const ComponentInfo> info) : data(std::move(info)) {}
+
+    void copyElementFrom(IComponentArray* source, size_t sourceIndex) override {
+        const auto* src = static_cast<const ByteArray*>(source);
+        data.pushCopy(src->data[sourceIndex]);
+    }
+
+    void moveElement(size_t fromIndex, size_t toIndex) override {
+        void* value = data[fromIndex];
+        data.mutableChunk(toIndex / chunkCapacity).assignMove(toIndex % chunkCapacity, value);
+    }
+
+    void removeLast() override { data.popBack(); }
+
+    std::unique_ptr<IComponentArray> clone() const override {
+        return std::make_unique<ByteArray>(*this);
+    }
+
+    ColumnStats stats() const override { return data.stats(); }
+
+    bool shrinkToFit() override { return data.shrinkToFit(); }
+
+    void permute(size_t first, const std::vector<size_t>& order) override {
+        data.permute(first, order);
+    }
+
+    void appendFrom(IComponentArray* source) override {
+        data.append(std::move(static_cast<ByteArray*>(source)->data));
+    }
+
+    std::unique_ptr<IComponentArray> createEmpty() const override {
+        return std::make_unique<ByteArray>(data.info);
+    }
+
+    void relocate(size_t c) override { data.relocate(c); }
+};
+
+// A system of World::forEachFused bound to the columns of one archetype.
+template <typename Func, typename... Components>
+struct BoundSystem {
+    Func* func;
+    // Null if the archetype does not match the system.
+    std::tuple<ComponentArray<std::decay_t<Components>>*...> arrays{};
+
+    bool active() const { return std::get<0>(arrays) != nullptr; }
+
+    // Returns the rows of chunk c of every column, null pointers if the system is inactive.
+    std::tuple<Components*...> chunk(size_t c) {
+        if (!active()) return {};
+        return std::apply(
+            [&](auto*... columns) { return std::make_tuple(chunkData<Components>(columns, c)...); },
+            arrays);
+    }
+
+    // Runs the system on row i of the chunk returned by chunk().
+    void run(const std::tuple<Components*...>& chunk, size_t i) {
+        if (!std::get<0>(chunk)) return;
+        std::apply([&](auto*... data) { (*func)(data[i]...); }, chunk);
+    }
 };
 
 // Archetype stores entities and their component arrays.
 struct Archetype {
     ArchetypeSignature signature;
-    std::vector<EntityId> entities;
+    Column<EntityId> entities;
     std::unordered_map<ComponentId, std::unique_ptr<IComponentArray>> componentData;
 
     Archetype() = default;
@@ -114,6 +793,27 @@ struct Archetype {
     Archetype(Archetype&&) noexcept = default;
     Archetype& operator=(Archetype&&) noexcept = default;
 
+    // Releases unused capacity of all columns. Returns true if rows moved in memory.
+    bool shrinkToFit() {
+        bool moved = entities.shrinkToFit();
+        for (auto& [id, array] : componentData) moved |= array->shrinkToFit();
+        return moved;
+    }
+
+    // Moves chunk c of all columns into memory of the calling thread.
+    void relocate(size_t c) {
+        entities.relocate(c);
+        for (auto& [id, array] : componentData) array->relocate(c);
+    }
+
+    // Explicit copy, sharing the chunks of all columns with this archetype.
+    Archetype clone() const {
+        Archetype copy{signature};
+        copy.entities = entities;
+        for (const auto& [id, array] : componentData) copy.componentData[id] = array->clone();
+        return copy;
+    }
+
     // Creates or retrieves a ComponentArray for a given component type T.
     // Needs the ComponentManager to convert the type T to an ID.
     template <typename T, typename ComponentManager>
@@ -126,97 +826,1254 @@ struct Archetype {
             componentData[id] = std::move(array);
             return ptr;
         }
-        return static_cast<ComponentArray<T>*>(componentData[id].get());
+        return static_cast<ComponentArray<T>*>(it->second.get());
+    }
+};
+
+// Type independent part of an observer, see World::observe.
+struct IObserver {
+    ObserverEvent event;
+    // Components of the observer.
+    ArchetypeSignature query;
+
+    explicit IObserver(ObserverEvent event, ArchetypeSignature query)
+        : event(event), query(query) {}
+    virtual ~IObserver() = default;
+    // Records the entities in the rows [first, first + count) of arch with their components.
+    // Called after the rows got the components, or before they lose them.
+    virtual void record(Archetype& arch, size_t first, size_t count) = 0;
+    // Takes the recorded events as the batch for deliver, recording restarts empty.
+    virtual void take() = 0;
+    // Hands the taken batch to the callback.
+    virtual void deliver() = 0;
+};
+
+template <typename ComponentManager, typename Func, typename... Components>
+struct Observer : IObserver {
+    Func func;
+    std::vector<EntityId> entities;
+    std::tuple<std::vector<Components>...> values;
+    std::vector<EntityId> batch;
+    std::tuple<std::vector<Components>...> batchValues;
+
+    Observer(ObserverEvent event, Func func)
+        : IObserver(event, (ComponentManager::template GetComponentMask<Components>() | ...)),
+          func(std::move(func)) {}
+
+    void record(Archetype& arch, size_t first, size_t count) override {
+        arch.entities.copyRange(first, count, entities);
+        (arch.getOrCreateComponentArray<Components, ComponentManager>()->data.copyRange(
+             first, count, std::get<std::vector<Components>>(values)),
+         ...);
+    }
+
+    void take() override {
+        batch.swap(entities);
+        batchValues.swap(values);
+        entities.clear();
+        std::apply([](auto&... columns) { (columns.clear(), ...); }, values);
+    }
+
+    void deliver() override {
+        if (batch.empty()) return;
+        std::apply(
+            [&](const auto&... columns) {
+                func(std::span<const EntityId>(batch), std::span<const Components>(columns)...);
+            },
+            batchValues);
+        batch.clear();
+        std::apply([](auto&... columns) { (columns.clear(), ...); }, batchValues);
     }
 };
 
+// Marks an unused slot in the EntityIndex.
+inline constexpr size_t invalidIndex = static_cast<size_t>(-1);
+
 // EntityLocation stores the archetype signature and index of an entity.
 // Used to map every entity to it's corresponding archetype plus the location of it's data in the
 // tables of components
 struct EntityLocation {
-    detail::ArchetypeSignature signature;
-    size_t indexInArchetype;
+    detail::ArchetypeSignature signature = 0;
+    size_t indexInArchetype = invalidIndex;
+};
+
+// Maps entity ids to their location.
+// Ids are handed out sequentially, so this is a paged array instead of a hash map and a lookup is
+// two indexed loads. Pages are allocated on first use, released when their last entity is
+// erased and shared copy-on-write between cloned worlds like column chunks. A few released pages
+// are kept for reuse, entities moving between worlds that share an id space (IdAllocator) would
+// otherwise allocate and free a page per move.
+class EntityIndex {
+   public:
+    // Returns the location of the entity or nullptr if it does not exist.
+    const EntityLocation* find(EntityId id) const {
+        size_t p = id / pageSize;
+        if (p >= pages.size() || !pages[p]) return nullptr;
+        const EntityLocation& location = pages[p]->slots[id % pageSize];
+        return location.indexInArchetype == invalidIndex ? nullptr : &location;
+    }
+
+    void set(EntityId id, EntityLocation location) {
+        size_t p = id / pageSize;
+        if (p >= pages.size()) pages.resize(p + 1);
+        if (!pages[p]) {
+            if (spare.empty()) {
+                pages[p] = std::make_shared<Page>();
+            } else {
+                pages[p] = std::move(spare.back());
+                spare.pop_back();
+            }
+        }
+        Page& page = mutablePage(p);
+        EntityLocation& slot = page.slots[id % pageSize];
+        if (slot.indexInArchetype == invalidIndex) {
+            ++page.live;
+            ++count;
+        }
+        slot = location;
+    }
+
+    void erase(EntityId id) {
+        if (!find(id)) return;
+        size_t p = id / pageSize;
+        Page& page = mutablePage(p);
+        page.slots[id % pageSize] = EntityLocation{};
+        --count;
+        if (--page.live == 0) {
+            if (spare.size() < maxSparePages && pages[p].use_count() == 1) {
+                spare.push_back(std::move(pages[p]));
+            }
+            pages[p].reset();
+        }
+    }
+
+    size_t size() const { return count; }
+
+    // Drops the page table entries after the last allocated page and the spare pages.
+    void shrinkToFit() {
+        while (!pages.empty() && !pages.back()) pages.pop_back();
+        pages.shrink_to_fit();
+        spare = {};
+    }
+
+    // Number of allocated pages and the bytes of the pages plus the page table.
+    size_t pageCount() const {
+        return std::count_if(pages.begin(), pages.end(), [](const auto& page) { return page; });
+    }
+    size_t bytes() const {
+        return (pageCount() + spare.size()) * sizeof(Page) +
+               pages.capacity() * sizeof(std::shared_ptr<Page>);
+    }
+    // Bytes of the pages still shared with a cloned world, part of bytes().
+    size_t sharedBytes() const {
+        return std::count_if(pages.begin(), pages.end(),
+                             [](const auto& page) { return page && page.use_count() > 1; }) *
+               sizeof(Page);
+    }
+
+    // Calls func(id, location) for every entity in ascending id order.
+    template <typename Func>
+    void forEach(Func func) const {
+        for (size_t p = 0; p < pages.size(); ++p) {
+            if (!pages[p]) continue;
+            for (size_t i = 0; i < pageSize; ++i) {
+                const EntityLocation& location = pages[p]->slots[i];
+                if (location.indexInArchetype == invalidIndex) continue;
+                func(static_cast<EntityId>(p * pageSize + i), location);
+            }
+        }
+    }
+
+   private:
+    static constexpr size_t pageSize = chunkCapacity;
+
+    struct Page {
+        std::array<EntityLocation, pageSize> slots{};
+        size_t live = 0;
+    };
+
+    std::vector<std::shared_ptr<Page>> pages{};
+    size_t count = 0;
+    // Released empty pages, all slots invalid
+    static constexpr size_t maxSparePages = 256;
+    std::vector<std::shared_ptr<Page>> spare{};
+
+    Page& mutablePage(size_t p) {
+        if (pages[p].use_count() > 1) pages[p] = std::make_shared<Page>(*pages[p]);
+        return *pages[p];
+    }
+};
+
+// Type independent part of a SparseSet.
+struct ISparseSet {
+    virtual ~ISparseSet() = default;
+    virtual size_t size() const = 0;
+    virtual bool contains(EntityId id) const = 0;
+    // Ids of the members in the order of their values.
+    virtual const std::vector<EntityId>& entities() const = 0;
+    // Does nothing if the entity is no member.
+    virtual void erase(EntityId id) = 0;
+    virtual std::unique_ptr<ISparseSet> clone() const = 0;
+    // An empty set of the same component.
+    virtual std::unique_ptr<ISparseSet> createEmpty() const = 0;
+    // Moves the value of the entity into target, a set of the same component. Does nothing if
+    // the entity is no member.
+    virtual void moveTo(EntityId id, ISparseSet& target) = 0;
+    // Moves all values into target, a set of the same component, and leaves this set empty.
+    virtual void moveAllTo(ISparseSet& target) = 0;
+    // Memory of the set, component is left 0.
+    virtual SparseSetStats stats() const = 0;
+};
+
+// Storage of a sparse component (ComponentManager::SparseComponentList), the sparse set design
+// of v2's ComponentStorage: the values are packed in a dense array with the id of each, a paged
+// index maps ids to their dense position. Adding and removing are O(1) and move no other
+// component of the entity, removing swaps the last value in. Index pages are allocated on first
+// use and released with their last member.
+template <typename T>
+struct SparseSet final : ISparseSet {
+    std::vector<EntityId> ids;
+    std::vector<T> values;
+
+    size_t size() const override { return ids.size(); }
+    bool contains(EntityId id) const override { return slot(id) != invalidIndex; }
+    const std::vector<EntityId>& entities() const override { return ids; }
+
+    T* find(EntityId id) {
+        size_t i = slot(id);
+        return i == invalidIndex ? nullptr : &values[i];
+    }
+
+    // Assigns the value if the entity already is a member.
+    template <typename U>
+    void insert(EntityId id, U&& value) {
+        if (T* existing = find(id)) {
+            *existing = std::forward<U>(value);
+            return;
+        }
+        setSlot(id, ids.size());
+        ids.push_back(id);
+        values.push_back(std::forward<U>(value));
+    }
+
+    void erase(EntityId id) override {
+        size_t i = slot(id);
+        if (i == invalidIndex) return;
+        size_t last = ids.size() - 1;
+        if (i != last) {
+            ids[i] = ids[last];
+            values[i] = std::move(values[last]);
+            setSlot(ids[i], i);
+        }
+        ids.pop_back();
+        values.pop_back();
+        setSlot(id, invalidIndex);
+    }
+
+    std::unique_ptr<ISparseSet> clone() const override {
+        auto copy = std::make_unique<SparseSet<T>>();
+        copy->ids = ids;
+        copy->values = values;
+        for (size_t i = 0; i < ids.size(); ++i) copy->setSlot(ids[i], i);
+        return copy;
+    }
+
+    std::unique_ptr<ISparseSet> createEmpty() const override {
+        return std::make_unique<SparseSet<T>>();
+    }
+
+    void moveTo(EntityId id, ISparseSet& target) override {
+        if (T* value = find(id)) {
+            static_cast<SparseSet<T>&>(target).insert(id, std::move(*value));
+            erase(id);
+        }
+    }
+
+    void moveAllTo(ISparseSet& target) override {
+        auto& other = static_cast<SparseSet<T>&>(target);
+        for (size_t i = 0; i < ids.size(); ++i) other.insert(ids[i], std::move(values[i]));
+        while (!ids.empty()) erase(ids.back());
+    }
+
+    SparseSetStats stats() const override {
+        SparseSetStats result;
+        result.elementSize = sizeof(T);
+        result.members = ids.size();
+        result.bytesUsed = ids.size() * (sizeof(T) + sizeof(EntityId));
+        result.valueBytes = values.capacity() * sizeof(T);
+        result.idBytes = ids.capacity() * sizeof(EntityId);
+        result.indexPages = std::count_if(pages.begin(), pages.end(),
+                                          [](const auto& page) { return page != nullptr; });
+        result.indexBytes =
+            result.indexPages * sizeof(Page) + pages.capacity() * sizeof(std::unique_ptr<Page>);
+        return result;
+    }
+
+   private:
+    static constexpr size_t pageSize = chunkCapacity;
+    static constexpr uint32_t emptySlot = std::numeric_limits<uint32_t>::max();
+
+    struct Page {
+        Page() { slots.fill(emptySlot); }
+        std::array<uint32_t, pageSize> slots;
+        size_t live = 0;
+    };
+    std::vector<std::unique_ptr<Page>> pages;
+
+    size_t slot(EntityId id) const {
+        size_t p = id / pageSize;
+        if (p >= pages.size() || !pages[p]) return invalidIndex;
+        uint32_t i = pages[p]->slots[id % pageSize];
+        return i == emptySlot ? invalidIndex : i;
+    }
+
+    void setSlot(EntityId id, size_t index) {
+        size_t p = id / pageSize;
+        if (p >= pages.size()) pages.resize(p + 1);
+        if (!pages[p]) pages[p] = std::make_unique<Page>();
+        uint32_t& slot = pages[p]->slots[id % pageSize];
+        if (index == invalidIndex) {
+            slot = emptySlot;
+            if (--pages[p]->live == 0) pages[p].reset();
+        } else {
+            if (slot == emptySlot) ++pages[p]->live;
+            slot = static_cast<uint32_t>(index);
+        }
+    }
 };
 }  // namespace detail
 
+// A callback with the components it queries, the unit World::forEachFused combines.
+template <typename Func, typename... Components>
+struct System {
+    static_assert(sizeof...(Components) > 0, "A system needs at least one component");
+    Func func;
+};
+
+// Creates a System, e.g. makeSystem<Position, const Velocity>([](Position&, const Velocity&) {}).
+template <typename... Components, typename Func>
+System<Func, Components...> makeSystem(Func func) {
+    return System<Func, Components...>{std::move(func)};
+}
+
+// The runtime components of the current row of a mixed query (World::forEach with
+// DynamicComponents), in the order they were queried.
+class DynamicRow {
+   public:
+    size_t size() const { return count; }
+
+    // The value of the k-th queried component.
+    void* operator[](size_t k) const { return bases[k] + row * sizes[k]; }
+
+    // The value of the k-th queried component as T, e.g. the C++ type it was registered from.
+    template <typename T>
+    T& get(size_t k) const {
+        return *static_cast<T*>((*this)[k]);
+    }
+
+   private:
+    template <typename>
+    friend class World;
+
+    DynamicRow(std::byte* const* bases, const size_t* sizes, size_t count, size_t row)
+        : bases(bases), sizes(sizes), count(count), row(row) {}
+
+    std::byte* const* bases;
+    const size_t* sizes;
+    size_t count;
+    size_t row;
+};
+
+// The rows of a query as a random-access range, returned by World::view, e.g.
+//   auto view = world.view<Position, const Velocity>();
+//   std::for_each(std::execution::par_unseq, view.begin(), view.end(), [](auto row) {
+//       auto [pos, vel] = row;
+//       pos.x += vel.dx;
+//   });
+// An element is a std::tuple of references into the columns, in the order forEach visits them.
+// The view is segmented: it holds one Segment per chunk of every matching archetype, a
+// contiguous run of rows with its own iterators. Parallel algorithms handed the flat iterators
+// split by index and pay a chunk lookup per access; handing them segments() instead splits at
+// chunk boundaries and runs the inner loop over plain arrays, as fast as forEach.
+// Chunks written through the view are detached from clones when the view is created. The view
+// is invalidated by structural changes like the pointers of a forEach.
+template <typename... Components>
+class QueryView {
+   public:
+    using reference = std::tuple<Components&...>;
+    using value_type = std::tuple<std::remove_const_t<Components>...>;
+
+    // The rows of one chunk, iterated by index.
+    class Segment {
+       public:
+        class iterator {
+           public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = QueryView::value_type;
+            using reference = QueryView::reference;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+
+            iterator() = default;
+
+            reference operator*() const { return (*segment)[i]; }
+            reference operator[](difference_type n) const { return (*segment)[i + n]; }
+            iterator& operator++() { return *this += 1; }
+            iterator operator++(int) { return iterator(segment, i++); }
+            iterator& operator--() { return *this -= 1; }
+            iterator operator--(int) { return iterator(segment, i--); }
+            iterator& operator+=(difference_type n) {
+                i += n;
+                return *this;
+            }
+            iterator& operator-=(difference_type n) { return *this += -n; }
+            friend iterator operator+(iterator it, difference_type n) { return it += n; }
+            friend iterator operator+(difference_type n, iterator it) { return it += n; }
+            friend iterator operator-(iterator it, difference_type n) { return it -= n; }
+            friend difference_type operator-(const iterator& a, const iterator& b) {
+                return difference_type(a.i) - difference_type(b.i);
+            }
+            friend bool operator==(const iterator& a, const iterator& b) { return a.i == b.i; }
+            friend auto operator<=>(const iterator& a, const iterator& b) { return a.i <=> b.i; }
+
+           private:
+            friend class Segment;
+
+            iterator(const Segment* segment, size_t i) : segment(segment), i(i) {}
+
+            const Segment* segment = nullptr;
+            size_t i = 0;
+        };
+
+        size_t size() const { return rows; }
+        reference operator[](size_t i) const {
+            return std::apply([i](auto*... columns) { return reference(columns[i]...); }, data);
+        }
+        iterator begin() const { return iterator(this, 0); }
+        iterator end() const { return iterator(this, rows); }
+
+       private:
+        friend class QueryView;
+
+        Segment(std::tuple<Components*...> data, size_t rows) : data(data), rows(rows) {}
+
+        std::tuple<Components*...> data;
+        size_t rows;
+    };
+
+    class iterator {
+       public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = QueryView::value_type;
+        using reference = QueryView::reference;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+
+        iterator() = default;
+
+        reference operator*() const { return view->chunks[chunk][row]; }
+        reference operator[](difference_type n) const { return *(*this + n); }
+
+        iterator& operator++() {
+            if (++row == view->chunks[chunk].size()) {
+                ++chunk;
+                row = 0;
+            }
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator old = *this;
+            ++*this;
+            return old;
+        }
+        iterator& operator--() {
+            if (row == 0) {
+                row = view->chunks[--chunk].size();
+            }
+            --row;
+            return *this;
+        }
+        iterator operator--(int) {
+            iterator old = *this;
+            --*this;
+            return old;
+        }
+
+        // Stays in the chunk if it can, else looks the chunk up in the page table.
+        iterator& operator+=(difference_type n) {
+            if (n >= 0 ? row + n < rowsOf(chunk) : size_t(-n) <= row) {
+                row += n;
+            } else {
+                seek(index() + n);
+            }
+            return *this;
+        }
+        iterator& operator-=(difference_type n) { return *this += -n; }
+        friend iterator operator+(iterator it, difference_type n) { return it += n; }
+        friend iterator operator+(difference_type n, iterator it) { return it += n; }
+        friend iterator operator-(iterator it, difference_type n) { return it -= n; }
+        friend difference_type operator-(const iterator& a, const iterator& b) {
+            return difference_type(a.index()) - difference_type(b.index());
+        }
+
+        friend bool operator==(const iterator& a, const iterator& b) {
+            return a.chunk == b.chunk && a.row == b.row;
+        }
+        friend auto operator<=>(const iterator& a, const iterator& b) {
+            return a.index() <=> b.index();
+        }
+
+       private:
+        friend class QueryView;
+
+        iterator(const QueryView* view, size_t chunk, size_t row)
+            : view(view), chunk(chunk), row(row) {}
+
+        const QueryView* view = nullptr;
+        size_t chunk = 0;
+        size_t row = 0;
+
+        size_t index() const { return view->offsets[chunk] + row; }
+        size_t rowsOf(size_t c) const {
+            return c < view->chunks.size() ? view->chunks[c].size() : 0;
+        }
+
+        void seek(size_t target) {
+            if (target >= view->size()) {
+                chunk = view->chunks.size();
+            } else {
+                chunk = view->pageChunks[target / detail::chunkCapacity];
+                while (view->offsets[chunk + 1] <= target) ++chunk;
+            }
+            row = target - view->offsets[chunk];
+        }
+    };
+
+    iterator begin() const { return iterator(this, 0, 0); }
+    iterator end() const { return iterator(this, chunks.size(), 0); }
+    size_t size() const { return offsets.back(); }
+    bool empty() const { return size() == 0; }
+    reference operator[](size_t i) const { return begin()[i]; }
+
+    std::span<const Segment> segments() const { return chunks; }
+
+   private:
+    template <typename>
+    friend class World;
+
+    QueryView() = default;
+
+    void push(std::tuple<Components*...> data, size_t rows) {
+        chunks.push_back(Segment(data, rows));
+        offsets.push_back(offsets.back() + rows);
+        while (pageChunks.size() * detail::chunkCapacity < offsets.back()) {
+            pageChunks.push_back(chunks.size() - 1);
+        }
+    }
+
+    std::vector<Segment> chunks;
+    // First row of every chunk, the total last
+    std::vector<size_t> offsets{0};
+    // Chunk of row p * chunkCapacity for every page p of rows, so an iterator finds the chunk of
+    // any row in O(1) steps: parallel algorithms index from the start of their part.
+    std::vector<size_t> pageChunks;
+};
+
+template <typename ComponentManager>
+class World;
+
+// Hands out blocks of entity ids to worlds sharing one id space, e.g. the shards of a
+// ShardedWorld, so an entity keeps its id when it moves between them. Thread-safe.
+class IdAllocator {
+   public:
+    // Ids a world reserves at once, one page of its entity index.
+    static constexpr EntityId blockSize = detail::chunkCapacity;
+
+    explicit IdAllocator(EntityId first = 0) : next(first) {}
+
+    // Returns the first of count consecutive unused ids.
+    EntityId reserve(EntityId count) { return next.fetch_add(count, std::memory_order_relaxed); }
+
+   private:
+    std::atomic<EntityId> next{0};
+};
+
+// Entities taken out of a world with all their components, grouped by archetype. Filled by
+// World::takeRows and emptied by World::insertRows of another world, the entities keep their ids.
+// Stays valid across worlds of the same ComponentManager only.
+class EntityRows {
+   public:
+    size_t size() const {
+        size_t total = 0;
+        for (const auto& arch : archetypes) total += arch.entities.size();
+        return total;
+    }
+    bool empty() const { return size() == 0; }
+
+   private:
+    template <typename>
+    friend class World;
+    template <typename>
+    friend class Spawner;
+
+    // Emptied archetypes are kept, their column objects are reused by the next takeRows.
+    std::vector<detail::Archetype> archetypes;
+    // Sparse components of the entities by component id, like World::sparseSets
+    std::vector<std::unique_ptr<detail::ISparseSet>> sparseSets;
+
+    detail::Archetype& archetype(detail::ArchetypeSignature signature) {
+        for (auto& arch : archetypes) {
+            if (arch.signature == signature) return arch;
+        }
+        archetypes.push_back(detail::Archetype{signature});
+        return archetypes.back();
+    }
+};
+
+// Creates entities on a worker thread, e.g. particles or projectiles, while other threads do the
+// same. Returned by World::spawner, one per thread. Ids are reserved in blocks from the
+// IdAllocator of the world and the rows are staged in chunks owned by the spawner, so spawning
+// touches no shared state but the atomic id counter. World::sync splices the staged rows into the
+// archetypes; until then the entities are not part of the world.
+template <typename ComponentManager>
+class Spawner {
+   public:
+    // Same as World::createEntity, the id is valid right away.
+    template <typename... Components>
+    EntityId createEntity(Components&&... components) {
+        static_assert(!ComponentManager::template HasSparse<Components...>(),
+                      "Sparse components are not supported here");
+        if (nextEntityId == idBlockEnd) {
+            nextEntityId = idAllocator->reserve(IdAllocator::blockSize);
+            idBlockEnd = nextEntityId + IdAllocator::blockSize;
+        }
+        EntityId id = nextEntityId++;
+        detail::ArchetypeSignature sig =
+            (ComponentManager::template GetComponentMask<std::decay_t<Components>>() | ...);
+
+        detail::Archetype& staging = rows.archetype(sig);
+        staging.entities.push_back(id);
+        (staging.getOrCreateComponentArray<std::decay_t<Components>, ComponentManager>()
+             ->push_back(std::forward<Components>(components)),
+         ...);
+        return id;
+    }
+
+    // Number of entities waiting for World::sync.
+    size_t size() const { return rows.size(); }
+
+   private:
+    friend class World<ComponentManager>;
+
+    explicit Spawner(IdAllocator& ids) : idAllocator(&ids) {}
+
+    IdAllocator* idAllocator;
+    EntityId nextEntityId = 0;
+    EntityId idBlockEnd = 0;
+    EntityRows rows;
+};
+
+// Read-only copy of the columns of some components, taken by World::snapshot, e.g. to draw a
+// tick on another thread while the simulation writes the next one.
+// The chunks are shared copy-on-write with the world like World::clone, so taking a snapshot
+// copies pointers only and the world copies a chunk when it first writes it afterwards: per tick
+// only the dirty chunks are copied.
+// Queries take a subset of Components and visit the rows in the same order as World::forEach.
+template <typename ComponentManager, typename... Components>
+class Snapshot {
+   public:
+    // Number of rows having all Query components.
+    template <typename... Query>
+    size_t count() const {
+        detail::ArchetypeSignature query = mask<Query...>();
+        size_t total = 0;
+        for (const Part& part : parts) {
+            if (detail::matchArchetypeSignatures(part.signature, query)) total += part.rows;
+        }
+        return total;
+    }
+
+    // Calls func(const Query&...) for every row having all Query components.
+    template <typename... Query, typename Func>
+    void forEach(Func func) const {
+        forEachInRange<Query...>(0, std::numeric_limits<size_t>::max(), func);
+    }
+
+    // Same as World::forEachInRange: visits the rows [first, last) of forEach.
+    template <typename... Query, typename Func>
+    void forEachInRange(size_t first, size_t last, Func func) const {
+        ECS_PROFILE_ZONE(zone, "Snapshot::forEachInRange");
+        detail::ArchetypeSignature query = mask<Query...>();
+        size_t offset = 0;
+        for (const Part& part : parts) {
+            if (offset >= last) break;
+            if (!detail::matchArchetypeSignatures(part.signature, query)) continue;
+            size_t begin = std::max(first, offset) - offset;
+            size_t end = std::min(last, offset + part.rows) - offset;
+            offset += part.rows;
+            if (begin >= end) continue;
+            ECS_PROFILE_ARCHETYPE(zone, end - begin);
+
+            for (size_t row = begin; row < end;) {
+                size_t c = row / detail::chunkCapacity, i = row % detail::chunkCapacity;
+                size_t stop = std::min(detail::chunkCapacity, i + (end - row));
+                row += stop - i;
+                auto chunks = std::make_tuple(
+                    std::get<detail::Column<std::decay_t<Query>>>(part.columns).chunk(c).data()...);
+                for (; i < stop; ++i) {
+                    std::apply([&](const auto*... data) { func(data[i]...); }, chunks);
+                }
+            }
+        }
+    }
+
+   private:
+    friend class World<ComponentManager>;
+
+    // The selected columns of one non-empty archetype, columns it lacks stay empty.
+    struct Part {
+        detail::ArchetypeSignature signature = 0;
+        size_t rows = 0;
+        std::tuple<detail::Column<Components>...> columns;
+    };
+    std::vector<Part> parts;
+
+    template <typename... Query>
+    static detail::ArchetypeSignature mask() {
+        static_assert((contains<std::decay_t<Query>>() && ...),
+                      "Query a snapshot only for its components");
+        return (ComponentManager::template GetComponentMask<std::decay_t<Query>>() | ...);
+    }
+
+    template <typename T>
+    static constexpr bool contains() {
+        return (std::is_same_v<T, Components> || ...);
+    }
+};
+
 // The main World class holds all entities, archetypes, and manages their interactions.
 // World needs all used Components at compile-time via the ComponentManager.
+// Components in a query may be const qualified (e.g. forEach<const Position, Velocity>) to only
+// read them, which keeps chunks shared with a cloned world shared. Such read-only queries may
+// run concurrently from several threads while nothing modifies the world.
 template <typename ComponentManager>
 class World {
    public:
+    World() = default;
+    // A world taking its entity ids from ids in blocks, instead of counting from 0 on its own.
+    // ids must outlive the world.
+    explicit World(IdAllocator& ids) : idAllocator(&ids) {}
+
+    // Handle for repeated access to the same entity, created by World::ref.
+    // Caches the addresses of the components of the entity, detached from a cloned world for the
+    // components it may write. The cache is checked against the structural version of the world,
+    // which changes whenever rows move, in the table (destroyEntity, addComponent, sorting) or
+    // only in memory (a chunk growing as entities are created, compact), and against the chunk
+    // version, which changes when chunks are shared (clone) or relocated. While both match an
+    // access is two compares and a load through the cached address. A read-only component in a
+    // chunk still shared with a clone is read through its column instead, since the chunk moves
+    // when either world writes it.
+    // The handle is invalid once the world is destroyed or moved.
+    template <typename... Components>
+    class EntityRef {
+       public:
+        static_assert(!ComponentManager::template HasSparse<Components...>(),
+                      "Sparse components are not supported here");
+
+        EntityRef(World& world, EntityId entityId) : world(&world), entityId(entityId) {
+            refresh();
+        }
+
+        EntityId id() const { return entityId; }
+
+        // Same as World::apply: calls func with the components of the entity.
+        // Throws std::out_of_range if the entity was destroyed and std::runtime_error if it no
+        // longer has all components.
+        template <typename Func>
+        void apply(Func func) {
+            validate();
+            func(component<Components>()...);
+        }
+
+        // Returns one component of the entity, with the same checks as apply.
+        template <typename T>
+        T& get() {
+            validate();
+            return component<T>();
+        }
+
+       private:
+        World* world;
+        EntityId entityId;
+        uint64_t version = 0;
+        uint64_t chunkVersion = 0;
+        size_t row = 0;
+        std::tuple<detail::ComponentArray<std::decay_t<Components>>*...> columns;
+        // Address of each component, null for a read-only one in a shared chunk
+        std::tuple<Components*...> addresses;
+
+        void validate() {
+            if (version != world->structuralVersion || chunkVersion != world->chunkVersion.load())
+                refresh();
+        }
+
+        template <typename T>
+        T& component() {
+            using Component = std::decay_t<T>;
+            if constexpr ((std::is_same_v<Component, Components> || ...)) {
+                return *std::get<Component*>(addresses);
+            } else {
+                // Declared read-only
+                if constexpr (std::is_const_v<T>) {
+                    if (const Component* address = std::get<const Component*>(addresses)) {
+                        return *address;
+                    }
+                }
+                return detail::element<T>(std::get<detail::ComponentArray<Component>*>(columns),
+                                          row);
+            }
+        }
+
+        // The address of component T in the row, detaching its chunk unless T is const.
+        template <typename T>
+        T* address(detail::ComponentArray<std::decay_t<T>>* array) const {
+            if constexpr (std::is_const_v<T>) {
+                if (array->data.shared(row / detail::chunkCapacity)) return nullptr;
+            }
+            return &detail::element<T>(array, row);
+        }
+
+        void refresh() {
+            detail::EntityLocation location = world->locate(entityId);
+            detail::Archetype* arch = world->getOrCreateArchetype(location.signature);
+            detail::ArchetypeSignature query =
+                (ComponentManager::template GetComponentMask<std::decay_t<Components>>() | ...);
+            if (!detail::matchArchetypeSignatures(arch->signature, query))
+                throw std::runtime_error("Entity does not contain the given Component.");
+            row = location.indexInArchetype;
+            columns = std::make_tuple(
+                arch->getOrCreateComponentArray<std::decay_t<Components>, ComponentManager>()...);
+            addresses = std::make_tuple(
+                address<Components>(
+                    std::get<detail::ComponentArray<std::decay_t<Components>>*>(columns))...);
+            version = world->structuralVersion;
+            chunkVersion = world->chunkVersion.load();
+        }
+    };
+
+    // Returns a handle for repeated access to the components of an entity, e.g. the player.
+    // Throws like apply if the entity does not exist or lacks a component.
+    template <typename... Components>
+    EntityRef<Components...> ref(EntityId entityId) {
+        return EntityRef<Components...>(*this, entityId);
+    }
+
     template <typename... Components>
     // Creates an entity with the specified components
     EntityId createEntity(Components&&... components) {
         EntityId id = generateEntityId();
-        detail::ArchetypeSignature sig =
+        detail::ArchetypeSignature sig = ComponentManager::template GetTableMask<Components...>();
+
+        detail::Archetype* archetype = getOrCreateArchetype(sig);
+        archetype->entities.push_back(id);
+        size_t index = archetype->entities.size() - 1;
+
+        // Add components to the archetype's component arrays, sparse ones to their sets
+        bool grown =
+            (false | ... | store<Components>(*archetype, id, std::forward<Components>(components)));
+        // The last chunk of a column grew, the rows in it moved in memory
+        if (grown) ++structuralVersion;
+
+        entityLocations.set(id, {archetype->signature, index});
+        notifyChanged(*archetype, index, 1, 0, sig);
+        return id;
+    }
+
+    // Applies a function to an entity
+    template <typename... Components, typename Func>
+    void apply(EntityId entityId, Func func) {
+        detail::EntityLocation location = locate(entityId);
+        detail::Archetype* arch = getOrCreateArchetype(location.signature);
+
+        // Build the query signature from the table components, sparse ones are checked by
+        // componentOf
+        detail::ArchetypeSignature query = ComponentManager::template GetTableMask<Components...>();
+
+        // Check if the archetype matches the component signature
+        if (!detail::matchArchetypeSignatures(arch->signature, query))
+            throw std::runtime_error("Entity does not contain the given Component.");
+
+        size_t index = location.indexInArchetype;
+
+        // Apply the function to the entity's components
+        func(componentOf<Components>(*arch, index, entityId)...);
+    }
+
+    // Applies a function to the components of many entities, e.g. collision pairs or AI targets.
+    // The ids are sorted by (archetype, chunk, row) with two counting passes, so the component
+    // arrays are resolved once per archetype and every chunk is visited once, front to back;
+    // func is not called in the order of ids. With prefetchDistance > 0 the components of the
+    // row that many calls ahead are prefetched, which only pays off for large components or
+    // expensive funcs. All ids are checked before the first call, throwing like apply.
+    template <typename... Components, typename Func>
+    void applyBatch(std::span<const EntityId> ids, Func func, size_t prefetchDistance = 0) {
+        static_assert(!ComponentManager::template HasSparse<Components...>(),
+                      "Sparse components are not supported here");
+        ECS_PROFILE_ZONE(zone, "World::applyBatch");
+        detail::ArchetypeSignature query =
             (ComponentManager::template GetComponentMask<std::decay_t<Components>>() | ...);
 
-        detail::Archetype* archetype = getOrCreateArchetype(sig);
-        archetype->entities.push_back(id);
-        size_t index = archetype->entities.size() - 1;
+        // signatures of the archetypes touched by the batch, numbered by bucket, and the
+        // (archetype, row) of every id
+        std::vector<detail::ArchetypeSignature> signatures;
+        std::unordered_map<detail::ArchetypeSignature, size_t> bucketOf;
+        // the buffers of the last call, taken so that a func calling applyBatch gets its own
+        auto locations = std::exchange(batchLocations, {});
+        auto rows = std::exchange(batchRows, {});
+        locations.clear();
+        // bucket of the previous id, neighbours often share the archetype
+        size_t bucket = detail::invalidIndex;
+        for (EntityId id : ids) {
+            detail::EntityLocation location = locate(id);
+            if (!detail::matchArchetypeSignatures(location.signature, query))
+                throw std::runtime_error("Entity does not contain the given Component.");
+            if (bucket == detail::invalidIndex || signatures[bucket] != location.signature) {
+                auto [it, added] = bucketOf.try_emplace(location.signature, signatures.size());
+                if (added) signatures.push_back(location.signature);
+                bucket = it->second;
+            }
+            locations.emplace_back(bucket, location.indexInArchetype);
+        }
+        // resolved after all ids are known, the archetypes already exist so none is created
+        std::vector<detail::Archetype*> touched;
+        for (auto signature : signatures) touched.push_back(getOrCreateArchetype(signature));
+
+        // counting sort by (archetype, chunk), firstChunk numbering the chunks of all archetypes,
+        // then one by the offset within each chunk while its rows are in cache
+        std::vector<size_t> firstChunk(touched.size() + 1, 0);
+        for (size_t a = 0; a < touched.size(); ++a) {
+            firstChunk[a + 1] = firstChunk[a] + touched[a]->entities.chunks.size();
+        }
+        std::vector<size_t> offsets(firstChunk.back() + 1, 0);
+        for (const auto& [a, row] : locations) {
+            ++offsets[firstChunk[a] + row / detail::chunkCapacity + 1];
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        rows.resize(locations.size());
+        {
+            std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+            for (const auto& [a, row] : locations) {
+                rows[next[firstChunk[a] + row / detail::chunkCapacity]++] = row;
+            }
+        }
+        {
+            std::vector<uint32_t> count(detail::chunkCapacity, 0);
+            for (size_t c = 0; c + 1 < offsets.size(); ++c) {
+                auto first = rows.begin() + offsets[c], last = rows.begin() + offsets[c + 1];
+                // a scan of all offsets does not pay off for a few rows
+                if (last - first < 64) {
+                    std::sort(first, last);
+                    continue;
+                }
+                size_t base = *first - *first % detail::chunkCapacity;
+                for (auto it = first; it != last; ++it) ++count[*it - base];
+                for (size_t offset = 0; offset < detail::chunkCapacity; ++offset) {
+                    for (; count[offset] > 0; --count[offset]) *first++ = base + offset;
+                }
+            }
+        }
+
+        for (size_t a = 0; a < touched.size(); ++a) {
+            size_t begin = offsets[firstChunk[a]], end = offsets[firstChunk[a + 1]];
+            ECS_PROFILE_ARCHETYPE(zone, end - begin);
+            detail::Archetype* arch = touched[a];
+            auto comps = std::make_tuple(
+                arch->getOrCreateComponentArray<std::decay_t<Components>, ComponentManager>()...);
+            std::apply(
+                [&](auto*... arrays) {
+                    // chunk pointers are resolved again only when the row enters a new chunk
+                    size_t chunk = detail::invalidIndex;
+                    std::tuple<Components*...> data{};
+                    for (size_t i = begin; i < end; ++i) {
+                        if (prefetchDistance > 0 && i + prefetchDistance < end) {
+                            size_t ahead = rows[i + prefetchDistance];
+                            (ECS_PREFETCH(&std::as_const(*arrays).get(ahead)), ...);
+                        }
+                        size_t row = rows[i];
+                        if (row / detail::chunkCapacity != chunk) {
+                            chunk = row / detail::chunkCapacity;
+                            data = std::make_tuple(detail::chunkData<Components>(arrays, chunk)...);
+                        }
+                        size_t offset = row % detail::chunkCapacity;
+                        std::apply([&](auto*... columns) { func(columns[offset]...); }, data);
+                    }
+                },
+                comps);
+        }
+        batchLocations = std::move(locations);
+        batchRows = std::move(rows);
+    }
+
+    // Applies a function to each entity that matches the specified components.
+    template <typename... Components, typename Func>
+    void forEach(Func func) {
+        if constexpr (ComponentManager::template HasSparse<Components...>()) {
+            forEachJoined<Components...>(func);
+        } else {
+            ECS_PROFILE_ZONE(zone, "World::forEach");
+            detail::ArchetypeSignature query =
+                (ComponentManager::template GetComponentMask<std::decay_t<Components>>() | ...);
+
+            // Iterate over all archetypes
+            for (auto& arch : archetypes) {
+                // Check if archetype has atleast the components of the query
+                if (!detail::matchArchetypeSignatures(arch.signature, query)) continue;
+                if (arch.entities.empty()) continue;
+
+                // Cache the component arrays for efficiency
+                auto comps = std::make_tuple(
+                    arch.getOrCreateComponentArray<std::decay_t<Components>,
+                                                   ComponentManager>()...);
+
+                size_t count = arch.entities.size();
+                ECS_PROFILE_ARCHETYPE(zone, count);
+
+                // Apply the function to each entity in the archetype, chunk by chunk
+                for (size_t c = 0, first = 0; first < count; ++c, first += detail::chunkCapacity) {
+                    size_t rows = std::min(detail::chunkCapacity, count - first);
+                    auto chunks = std::apply(
+                        [&](auto*... arrays) {
+                            return std::make_tuple(detail::chunkData<Components>(arrays, c)...);
+                        },
+                        comps);
+                    for (size_t i = 0; i < rows; ++i) {
+                        std::apply([&](auto*... data) { func(data[i]...); }, chunks);
+                    }
+                }
+            }
+        }
+    }
+
+    // Same as forEach, but the entities also need the runtime components in dynamic, which func
+    // gets as a DynamicRow after the typed ones, e.g.
+    //   world.forEach<Position>(dynamic, [](Position& pos, ecs::DynamicRow row) { ... });
+    // The typed columns are iterated as in forEach, the runtime ones through one base pointer and
+    // element size per chunk.
+    template <typename... Components, typename Func>
+    void forEach(std::span<const DynamicComponent> dynamic, Func func) {
+        static_assert(!ComponentManager::template HasSparse<Components...>(),
+                      "Sparse components are not supported here");
+        ECS_PROFILE_ZONE(zone, "World::forEach");
+        detail::ArchetypeSignature query =
+            (detail::ArchetypeSignature{0} | ... |
+             ComponentManager::template GetComponentMask<std::decay_t<Components>>());
+        for (const DynamicComponent& component : dynamic) query |= component.mask();
+
+        std::vector<detail::ByteArray*> columns(dynamic.size());
+        std::vector<std::byte*> bases(dynamic.size());
+        std::vector<size_t> sizes(dynamic.size());
+        for (size_t k = 0; k < dynamic.size(); ++k) sizes[k] = componentInfo(dynamic[k]).size;
+
+        for (auto& arch : archetypes) {
+            if (!detail::matchArchetypeSignatures(arch.signature, query)) continue;
+            if (arch.entities.empty()) continue;
+
+            auto comps = std::make_tuple(
+                arch.getOrCreateComponentArray<std::decay_t<Components>, ComponentManager>()...);
+            for (size_t k = 0; k < dynamic.size(); ++k) columns[k] = byteArray(arch, dynamic[k]);
+
+            size_t count = arch.entities.size();
+            ECS_PROFILE_ARCHETYPE(zone, count);
+
+            for (size_t c = 0, first = 0; first < count; ++c, first += detail::chunkCapacity) {
+                size_t rows = std::min(detail::chunkCapacity, count - first);
+                auto chunks = std::apply(
+                    [&](auto*... arrays) {
+                        return std::make_tuple(detail::chunkData<Components>(arrays, c)...);
+                    },
+                    comps);
+                for (size_t k = 0; k < dynamic.size(); ++k) {
+                    bases[k] = columns[k]->data.mutableChunk(c).data();
+                }
+                for (size_t i = 0; i < rows; ++i) {
+                    DynamicRow row(bases.data(), sizes.data(), dynamic.size(), i);
+                    std::apply([&](auto*... data) { func(data[i]..., row); }, chunks);
+                }
+            }
+        }
+    }
+
+    // Returns the rows forEach<Components...> visits as a random-access range, see QueryView.
+    template <typename... Components>
+    QueryView<Components...> view() {
+        static_assert(!ComponentManager::template HasSparse<Components...>(),
+                      "Sparse components are not supported here");
+        detail::ArchetypeSignature query =
+            (ComponentManager::template GetComponentMask<std::decay_t<Components>>() | ...);
+        QueryView<Components...> result;
+        for (auto& arch : archetypes) {
+            if (!detail::matchArchetypeSignatures(arch.signature, query)) continue;
+            if (arch.entities.empty()) continue;
+            auto comps = std::make_tuple(
+                arch.getOrCreateComponentArray<std::decay_t<Components>, ComponentManager>()...);
+            size_t count = arch.entities.size();
+            for (size_t c = 0, first = 0; first < count; ++c, first += detail::chunkCapacity) {
+                result.push(std::apply(
+                                [&](auto*... arrays) {
+                                    return std::make_tuple(
+                                        detail::chunkData<Components>(arrays, c)...);
+                                },
+                                comps),
+                            std::min(detail::chunkCapacity, count - first));
+            }
+        }
+        return result;
+    }
 
-        // Add components to the archetype's component arrays
-        (archetype->getOrCreateComponentArray<std::decay_t<Components>, ComponentManager>()
-             ->push_back(std::forward<Components>(components)),
-         ...);
+    // Runs several systems in one pass instead of one forEach each, so components several systems
+    // use are streamed through the cache once. Every archetype matching at least one system is
+    // visited once, and every row is handed to the matching systems in the given order. For an
+    // entity the systems run in order as with separate passes; a system reading other entities
+    // may see them before or after the earlier systems ran. Like forEach, the systems are copied.
+    template <typename... Systems>
+    void forEachFused(Systems... systems) {
+        ECS_PROFILE_ZONE(zone, "World::forEachFused");
+        for (auto& arch : archetypes) {
+            if (arch.entities.empty()) continue;
+            auto bound = std::make_tuple(bindSystem(arch, systems)...);
+            bool any = std::apply([](const auto&... b) { return (b.active() || ...); }, bound);
+            if (!any) continue;
 
-        entityLocationMap[id] = {archetype->signature, index};
-        return id;
+            size_t count = arch.entities.size();
+            ECS_PROFILE_ARCHETYPE(zone, count);
+            for (size_t c = 0, first = 0; first < count; ++c, first += detail::chunkCapacity) {
+                size_t rows = std::min(detail::chunkCapacity, count - first);
+                std::apply(
+                    [&](auto&... b) {
+                        // braces evaluate in order, so a system reading a chunk after one that
+                        // wrote it (and detached it from a clone) sees the written chunk
+                        std::tuple<decltype(b.chunk(c))...> chunks{b.chunk(c)...};
+                        for (size_t i = 0; i < rows; ++i) {
+                            std::apply([&](auto&... data) { (b.run(data, i), ...); }, chunks);
+                        }
+                    },
+                    bound);
+            }
+        }
     }
 
-    // Applies a function to an entity
+    // Like forEach, but only visits the matching rows [first, last) in the order forEach visits
+    // them, count<Components...>() being the total. Splits a query into disjoint parts that run
+    // on different threads. Writing a chunk still shared with a clone copies it, which is not
+    // thread safe: call detachChunks<Components...>(first, last) for the whole range before
+    // handing writable parts to several threads.
     template <typename... Components, typename Func>
-    void apply(EntityId entityId, Func func) {
-        auto it = entityLocationMap.find(entityId);
-        if (it == entityLocationMap.end()) throw std::out_of_range("Entity not found.");
-        auto signature = it->second.signature;
-        detail::Archetype* arch = getOrCreateArchetype(signature);
-
-        // Build the query signature from the components
+    void forEachInRange(size_t first, size_t last, Func func) {
+        static_assert(!ComponentManager::template HasSparse<Components...>(),
+                      "Sparse components are not supported here");
+        ECS_PROFILE_ZONE(zone, "World::forEachInRange");
         detail::ArchetypeSignature query =
             (ComponentManager::template GetComponentMask<std::decay_t<Components>>() | ...);
 
-        // Check if the archetype matches the component signature
-        if (!detail::matchArchetypeSignatures(arch->signature, query))
-            throw std::runtime_error("Entity does not contain the given Component.");
+        // offset: matching rows of the archetypes before arch
+        size_t offset = 0;
+        for (auto& arch : archetypes) {
+            if (offset >= last) break;
+            if (!detail::matchArchetypeSignatures(arch.signature, query)) continue;
+            size_t count = arch.entities.size();
+            size_t begin = std::max(first, offset) - offset;
+            size_t end = std::min(last, offset + count) - offset;
+            offset += count;
+            if (begin >= end) continue;
 
-        size_t index = it->second.indexInArchetype;
+            auto comps = std::make_tuple(
+                arch.getOrCreateComponentArray<std::decay_t<Components>, ComponentManager>()...);
+            ECS_PROFILE_ARCHETYPE(zone, end - begin);
 
-        // Apply the function to the entity's components
-        func((arch->getOrCreateComponentArray<std::decay_t<Components>, ComponentManager>()->get(
-            index))...);
+            // Same inner loop as forEach, over the part of each chunk within the range
+            for (size_t row = begin; row < end;) {
+                size_t c = row / detail::chunkCapacity, i = row % detail::chunkCapacity;
+                size_t stop = std::min(detail::chunkCapacity, i + (end - row));
+                row += stop - i;
+                auto chunks = std::apply(
+                    [&](auto*... arrays) {
+                        return std::make_tuple(detail::chunkData<Components>(arrays, c)...);
+                    },
+                    comps);
+                for (; i < stop; ++i) {
+                    std::apply([&](auto*... data) { func(data[i]...); }, chunks);
+                }
+            }
+        }
     }
 
-    // Applies a function to each entity that matches the specified components.
-    template <typename... Components, typename Func>
-    void forEach(Func func) {
+    // Moves the chunks that start within the matching rows [first, last), the rows
+    // forEachInRange visits, into memory allocated and first written by the calling thread, so
+    // they end up on its NUMA node (see memory.hpp). The workers of a parallel forEachInRange
+    // split call it for their own ranges, concurrently, and then iterate node-local chunks; pin
+    // the workers to their nodes for the placement to pay off. All columns of a chunk move
+    // together and rows keep their order, but views and pointers to components are invalidated.
+    // Chunks shared with a cloned world stay where they are.
+    template <typename... Components>
+    void relocateChunks(size_t first, size_t last) {
+        static_assert(!ComponentManager::template HasSparse<Components...>(),
+                      "Sparse components are not supported here");
+        ECS_PROFILE_ZONE(zone, "World::relocateChunks");
+        chunkVersion.increment();
         detail::ArchetypeSignature query =
             (ComponentManager::template GetComponentMask<std::decay_t<Components>>() | ...);
 
-        // Iterate over all archetypes
+        // offset: matching rows of the archetypes before arch
+        size_t offset = 0;
         for (auto& arch : archetypes) {
-            // Check if archetype has atleast the components of the query
+            if (offset >= last) break;
             if (!detail::matchArchetypeSignatures(arch.signature, query)) continue;
+            size_t count = arch.entities.size();
+            ECS_PROFILE_ARCHETYPE(zone, count);
+            for (size_t c = 0, start = offset; c * detail::chunkCapacity < count;
+                 ++c, start += detail::chunkCapacity) {
+                if (start >= first && start < last) arch.relocate(c);
+            }
+            offset += count;
+        }
+    }
 
-            // Cache the component arrays for efficiency
-            auto comps = std::make_tuple(
-                arch.getOrCreateComponentArray<std::decay_t<Components>, ComponentManager>()...);
+    // Copies the chunks the matching rows [first, last) touch of the non-const Components that
+    // are still shared with a cloned world (see Column::mutableChunk). forEachInRange writes
+    // them in place afterwards, so threads writing different parts of one chunk do not race on
+    // its copy. Call it before fanning out; views detach their chunks when created.
+    template <typename... Components>
+    void detachChunks(size_t first, size_t last) {
+        static_assert(!ComponentManager::template HasSparse<Components...>(),
+                      "Sparse components are not supported here");
+        detail::ArchetypeSignature query =
+            (ComponentManager::template GetComponentMask<std::decay_t<Components>>() | ...);
 
+        // offset: matching rows of the archetypes before arch
+        size_t offset = 0;
+        for (auto& arch : archetypes) {
+            if (offset >= last) break;
+            if (!detail::matchArchetypeSignatures(arch.signature, query)) continue;
             size_t count = arch.entities.size();
+            size_t begin = std::max(first, offset) - offset;
+            size_t end = std::min(last, offset + count) - offset;
+            offset += count;
+            if (begin >= end) continue;
 
-            // Apply the function to each entity in the archetype
-            for (size_t i = 0; i < count; ++i) {
-                std::apply([&](auto*... arrays) { func((arrays->get(i))...); }, comps);
+            auto comps = std::make_tuple(
+                arch.getOrCreateComponentArray<std::decay_t<Components>, ComponentManager>()...);
+            for (size_t c = begin / detail::chunkCapacity; c * detail::chunkCapacity < end; ++c) {
+                std::apply(
+                    [&](auto*... arrays) { ((void)detail::chunkData<Components>(arrays, c), ...); },
+                    comps);
             }
         }
     }
+
     template <typename Func>
     void forEachEntity(Func func) {
-        for (auto entityLocation : entityLocationMap) {
-            auto id = entityLocation.first;
-            auto location = entityLocation.second;
-            func(id, location);
-        }
+        entityLocations.forEach(
+            [&](EntityId id, const detail::EntityLocation& location) { func(id, location); });
     }
 
     // check if type t is in a list of types
@@ -235,34 +2092,43 @@ class World {
     // the entities list. Same for the Components. Finally pop last element to remove effectively
     // the element. -> Remove is O(1)
     template <typename... AllComponents, typename... NewComponents>
+        requires(sizeof...(AllComponents) > 0)
     void addComponent(EntityId entityId, NewComponents&&... newComponents) {
         static_assert(sizeof...(NewComponents) <= sizeof...(AllComponents),
                       "You must pass exactly the new components for the added types");
 
         // Look up the entity
-        auto it = entityLocationMap.find(entityId);
-        if (it == entityLocationMap.end()) throw std::out_of_range("Entity not found.");
-
-        // Temp save old meta data
-        detail::Archetype* oldArch = getOrCreateArchetype(it->second.signature);
-        size_t oldIndex = it->second.indexInArchetype;
+        detail::EntityLocation location = locate(entityId);
 
-        size_t lastIndex = oldArch->entities.size() - 1;
-
-        // Build the new signature from all components
+        // Build the new signature from all table components, runtime components are kept
         detail::ArchetypeSignature newSignature =
-            (ComponentManager::template GetComponentMask<std::decay_t<AllComponents>>() | ...);
+            ComponentManager::template GetTableMask<AllComponents...>() |
+            (location.signature & ~staticMask);
 
-        // Early-out: no change
-        if (oldArch->signature == newSignature) return;
+        // Early-out: the archetype does not change, only sparse components are stored
+        if (location.signature == newSignature) {
+            (storeSparse<NewComponents>(entityId, std::forward<NewComponents>(newComponents)),
+             ...);
+            return;
+        }
 
+        // Create the new archetype first, creating it may move the old one in memory
         detail::Archetype* newArch = getOrCreateArchetype(newSignature);
+
+        // Temp save old meta data
+        detail::Archetype* oldArch = getOrCreateArchetype(location.signature);
+        size_t oldIndex = location.indexInArchetype;
+
+        size_t lastIndex = oldArch->entities.size() - 1;
+
         newArch->entities.push_back(entityId);
         size_t newIndex = newArch->entities.size() - 1;
 
         // function to move existing components (not part of newComponents) from old to new
         auto moveExisting = [&]<typename T>() {
-            if (!contains_type<T, NewComponents...>()) {
+            if constexpr (ComponentManager::template IsSparse<std::decay_t<T>>()) {
+                // stays in its sparse set
+            } else if (!contains_type<T, NewComponents...>()) {
                 detail::ComponentArray<T>* src =
                     oldArch->getOrCreateComponentArray<T, ComponentManager>();
                 detail::ComponentArray<T>* dst =
@@ -280,34 +2146,143 @@ class World {
         // execute move fuction for each Component
         (moveExisting.template operator()<AllComponents>(), ...);
 
-        // insert new component data into each table
-        (newArch->getOrCreateComponentArray<std::decay_t<NewComponents>, ComponentManager>()
-             ->push_back(std::forward<NewComponents>(newComponents)),
+        // move the runtime components, which are not part of the type list
+        for (auto& [id, array] : oldArch->componentData) {
+            if (id < staticComponentCount) continue;
+            auto& column = newArch->componentData[id];
+            if (!column) column = array->createEmpty();
+            column->copyElementFrom(array.get(), oldIndex);
+            if (oldIndex != lastIndex) array->moveElement(lastIndex, oldIndex);
+            array->removeLast();
+        }
+
+        // insert new component data into each table, sparse ones into their sets
+        (store<NewComponents>(*newArch, entityId, std::forward<NewComponents>(newComponents)),
          ...);
 
         // update entity location
-        entityLocationMap[entityId] = {newSignature, newIndex};
+        entityLocations.set(entityId, {newSignature, newIndex});
+        ++structuralVersion;
 
         // if the entity is not the last index, swap entityId with last index
         if (oldIndex != lastIndex) {
             std::swap(oldArch->entities[lastIndex], oldArch->entities[oldIndex]);
             EntityId swapId = oldArch->entities[oldIndex];
             // update
-            entityLocationMap[swapId] = detail::EntityLocation{oldArch->signature, oldIndex};
+            entityLocations.set(swapId, detail::EntityLocation{oldArch->signature, oldIndex});
         }
         // remove entity from old arch
         oldArch->entities.pop_back();
+
+        notifyChanged(*newArch, newIndex, 1, location.signature,
+                      ComponentManager::template GetTableMask<NewComponents...>());
+    }
+
+    // Removes the given components from an entity, moving its other components to the matching
+    // archetype like addComponent. Components the entity does not have are ignored.
+    template <typename... Removed>
+    void removeComponent(EntityId entityId) {
+        detail::EntityLocation location = locate(entityId);
+        (eraseSparse<Removed>(entityId), ...);
+        detail::ArchetypeSignature newSignature =
+            location.signature & ~ComponentManager::template GetTableMask<Removed...>();
+        if (location.signature == newSignature) return;
+        notifyRemoved(*getOrCreateArchetype(location.signature), location.indexInArchetype, 1,
+                      newSignature);
+        moveRow(entityId, location, newSignature);
+    }
+
+    // Assigns a new value to a component the entity already has and raises OnSet. Writes through
+    // apply or forEach raise no events, nor do sparse components. Throws like apply.
+    template <typename T>
+    void set(EntityId entityId, T&& value) {
+        using Component = std::decay_t<T>;
+        if constexpr (ComponentManager::template IsSparse<Component>()) {
+            locate(entityId);
+            Component* component = findSparse<Component>(entityId);
+            if (!component)
+                throw std::runtime_error("Entity does not contain the given Component.");
+            *component = std::forward<T>(value);
+        } else {
+            detail::EntityLocation location = locate(entityId);
+            detail::Archetype* arch = getOrCreateArchetype(location.signature);
+            if (!hasComponent<Component>(*arch))
+                throw std::runtime_error("Entity does not contain the given Component.");
+            arch->getOrCreateComponentArray<Component, ComponentManager>()->get(
+                location.indexInArchetype) = std::forward<T>(value);
+            notifyChanged(*arch, location.indexInArchetype, 1, arch->signature,
+                          ComponentManager::template GetComponentMask<Component>());
+        }
+    }
+
+    // Registers a component type defined at runtime, e.g. by a script. Its values are stored in
+    // type-erased byte columns next to the typed ones and it takes the signature bit after the
+    // ComponentList and the runtime components registered before, so all component types together
+    // are limited to the bits of an ArchetypeSignature. Throws std::invalid_argument if the
+    // alignment is no power of two or a destroy function comes without copy and move, and
+    // std::length_error if the signature is full.
+    DynamicComponent registerComponent(ComponentInfo info) {
+        if (info.alignment == 0 || (info.alignment & (info.alignment - 1)) != 0)
+            throw std::invalid_argument("Component alignment must be a power of two.");
+        if (info.destroy && (!info.copy || !info.move))
+            throw std::invalid_argument("Components with a destroy function need copy and move.");
+        size_t id = staticComponentCount + dynamicComponents.size();
+        if (id >= std::numeric_limits<detail::ArchetypeSignature>::digits)
+            throw std::length_error("Too many component types for the archetype signature.");
+        dynamicComponents.push_back(std::make_shared<const ComponentInfo>(std::move(info)));
+        return DynamicComponent{id};
+    }
+
+    const ComponentInfo& componentInfo(DynamicComponent component) const {
+        return *dynamicComponents.at(component.id - staticComponentCount);
+    }
+
+    // Adds a runtime component with a copy of *value, moving the entity to the matching archetype
+    // like addComponent. Overwrites the value if the entity already has the component.
+    void addComponent(EntityId entityId, DynamicComponent component, const void* value) {
+        detail::EntityLocation location = locate(entityId);
+        if ((location.signature & component.mask()) != 0) {
+            detail::Archetype* arch = getOrCreateArchetype(location.signature);
+            size_t row = location.indexInArchetype;
+            byteArray(*arch, component)
+                ->data.mutableChunk(row / detail::chunkCapacity)
+                .assignCopy(row % detail::chunkCapacity, value);
+        } else {
+            size_t row = moveRow(entityId, location, location.signature | component.mask());
+            detail::Archetype* arch = getOrCreateArchetype(location.signature | component.mask());
+            byteArray(*arch, component)->data.pushCopy(value);
+            notifyChanged(*arch, row, 1, location.signature, component.mask());
+        }
+    }
+
+    // Removes a runtime component like removeComponent, ignored if the entity does not have it.
+    void removeComponent(EntityId entityId, DynamicComponent component) {
+        detail::EntityLocation location = locate(entityId);
+        if ((location.signature & component.mask()) == 0) return;
+        detail::ArchetypeSignature newSignature = location.signature & ~component.mask();
+        notifyRemoved(*getOrCreateArchetype(location.signature), location.indexInArchetype, 1,
+                      newSignature);
+        moveRow(entityId, location, newSignature);
+    }
+
+    // Returns the value of a runtime component of the entity. Throws like apply.
+    void* get(EntityId entityId, DynamicComponent component) {
+        detail::EntityLocation location = locate(entityId);
+        if ((location.signature & component.mask()) == 0)
+            throw std::runtime_error("Entity does not contain the given Component.");
+        detail::Archetype* arch = getOrCreateArchetype(location.signature);
+        return byteArray(*arch, component)->data[location.indexInArchetype];
     }
 
     // Delete the given entity.
     void destroyEntity(EntityId entityId) {
         // Look up the entity.
-        auto it = entityLocationMap.find(entityId);
-        if (it == entityLocationMap.end()) throw std::out_of_range("Entity not found.");
+        detail::EntityLocation location = locate(entityId);
 
-        detail::Archetype* archeType = getOrCreateArchetype(it->second.signature);
-        size_t index = it->second.indexInArchetype;
+        detail::Archetype* archeType = getOrCreateArchetype(location.signature);
+        size_t index = location.indexInArchetype;
         size_t lastIndex = archeType->entities.size() - 1;
+        notifyRemoved(*archeType, index, 1, 0);
 
         // Delete all components of the entity.
         for (auto& i : archeType->componentData) {
@@ -323,26 +2298,795 @@ class World {
             std::swap(archeType->entities[lastIndex], archeType->entities[index]);
             EntityId swapId = archeType->entities[index];
             // Update the location of the swapped entity.
-            entityLocationMap[swapId] = detail::EntityLocation{archeType->signature, index};
+            entityLocations.set(swapId, detail::EntityLocation{archeType->signature, index});
         }
         archeType->entities.pop_back();
+        eraseSparse(entityId);
 
         // Delete the location of the entity.
-        entityLocationMap.erase(entityId);
+        entityLocations.erase(entityId);
+        ++structuralVersion;
+    }
+
+    // Adds the last component type with the given value to every entity that has all other
+    // types and does not have it yet, e.g. world.addComponentToAll<Position, Circle, Velocity>(
+    // Velocity{1, 0}) gives every Position + Circle entity a Velocity.
+    // Moves whole archetypes instead of single rows: every column is appended to the target at
+    // once, and its chunks are taken over as they are if the target ends on a chunk boundary (e.g.
+    // is empty). Returns the number of entities that got the component.
+    template <typename... Types>
+    size_t addComponentToAll(const detail::LastType<Types...>& value) {
+        static_assert(!ComponentManager::template HasSparse<Types...>(),
+                      "Sparse components are not supported here");
+        ECS_PROFILE_ZONE(zone, "World::addComponentToAll");
+        using New = detail::LastType<Types...>;
+        detail::ArchetypeSignature added = ComponentManager::template GetComponentMask<New>();
+        detail::ArchetypeSignature query =
+            (ComponentManager::template GetComponentMask<std::decay_t<Types>>() | ...) & ~added;
+
+        size_t moved = 0;
+        for (detail::ArchetypeSignature signature : bulkSources(query, added)) {
+            size_t first = moveAllRows(signature, signature | added);
+            detail::Archetype* target = getOrCreateArchetype(signature | added);
+            size_t rows = target->entities.size() - first;
+            auto* column = target->getOrCreateComponentArray<New, ComponentManager>();
+            column->data.appendCopies(value, rows);
+            notifyChanged(*target, first, rows, signature, added);
+            ECS_PROFILE_ARCHETYPE(zone, rows);
+            moved += rows;
+        }
+        if (moved > 0) ++structuralVersion;
+        return moved;
+    }
+
+    // Removes the last component type from every entity that has all the types, moving whole
+    // archetypes like addComponentToAll. Returns the number of entities that lost the component.
+    template <typename... Types>
+    size_t removeComponentFromAll() {
+        static_assert(!ComponentManager::template HasSparse<Types...>(),
+                      "Sparse components are not supported here");
+        ECS_PROFILE_ZONE(zone, "World::removeComponentFromAll");
+        detail::ArchetypeSignature removed =
+            ComponentManager::template GetComponentMask<detail::LastType<Types...>>();
+        detail::ArchetypeSignature query =
+            (ComponentManager::template GetComponentMask<std::decay_t<Types>>() | ...);
+
+        size_t moved = 0;
+        for (detail::ArchetypeSignature signature : bulkSources(query, 0)) {
+            detail::Archetype* source = getOrCreateArchetype(signature);
+            notifyRemoved(*source, 0, source->entities.size(), signature & ~removed);
+            size_t first = moveAllRows(signature, signature & ~removed);
+            size_t rows = getOrCreateArchetype(signature & ~removed)->entities.size() - first;
+            ECS_PROFILE_ARCHETYPE(zone, rows);
+            moved += rows;
+        }
+        if (moved > 0) ++structuralVersion;
+        return moved;
+    }
+
+    // Registers func for Event on entities with all Components, e.g.
+    //   world.observe<ecs::ObserverEvent::OnAdd, Position, Velocity>(
+    //       [](std::span<const EntityId> ids, std::span<const Position> positions,
+    //          std::span<const Velocity> velocities) { ... });
+    // Structural changes only record the entity ids and a copy of the components, func is called
+    // by sync with everything recorded since the last sync, all spans of equal length.
+    // OnAdd and OnSet carry the values after the change, OnRemove the last values. Creating an
+    // entity raises OnAdd and OnSet; OnSet is further raised by addComponent, addComponentToAll
+    // and set if they write one of the Components. Observers are not copied by clone.
+    template <ObserverEvent Event, typename... Components, typename Func>
+    void observe(Func func) {
+        static_assert(sizeof...(Components) > 0, "An observer needs at least one component");
+        static_assert(!ComponentManager::template HasSparse<Components...>(),
+                      "Sparse components are not supported here");
+        observers.push_back(
+            std::make_unique<detail::Observer<ComponentManager, Func, std::decay_t<Components>...>>(
+                Event, std::move(func)));
+    }
+
+    // Returns a new Spawner for one worker thread. Call it on the thread owning the world, the
+    // world keeps the spawner until it is destroyed. A world without IdAllocator switches to an
+    // own one here, so its ids and those of its spawners come from one atomic counter.
+    Spawner<ComponentManager>& spawner() {
+        if (!idAllocator) {
+            ownIdAllocator = std::make_shared<IdAllocator>(nextEntityId);
+            idAllocator = ownIdAllocator.get();
+            idBlockEnd = nextEntityId;
+        }
+        // Not make_unique, the constructor is private
+        auto* spawner = new Spawner<ComponentManager>(*idAllocator);
+        spawners.push_back(std::unique_ptr<Spawner<ComponentManager>>(spawner));
+        return *spawners.back();
+    }
+
+    // The sync point of the world, called while no other thread uses it. Splices the rows staged
+    // by all spawners into the archetypes (taking their chunks over where an archetype ends on a
+    // chunk boundary), then delivers the recorded observer events, one call per observer with
+    // pending events, in the order the observers were registered. Events raised by the callbacks
+    // are delivered by the next sync.
+    void sync() {
+        ECS_PROFILE_SCOPE("World::sync");
+        for (auto& spawner : spawners) insertRows(spawner->rows);
+        for (auto& observer : observers) observer->take();
+        // By index, a callback may register further observers
+        for (size_t i = 0; i < observers.size(); ++i) observers[i]->deliver();
+    }
+
+    // Moves the entities with a Key component for which route(const Key&) returns an index into
+    // out, with all their components, into out[index], e.g. to hand them to the world of another
+    // thread. Entities for which route returns out.size() or more stay. Each row is routed once.
+    // Sparse components travel with their entities. Returns the number of entities taken.
+    template <typename Key, typename Route>
+    size_t takeRows(Route route, std::span<EntityRows> out) {
+        static_assert(!ComponentManager::template HasSparse<Key>(),
+                      "Sparse components are not supported here");
+        ECS_PROFILE_ZONE(zone, "World::takeRows");
+        size_t taken = 0;
+        // Leaving rows of an archetype with their target, reused
+        std::vector<std::pair<size_t, size_t>> leaving;
+        for (auto& arch : archetypes) {
+            if (!hasComponent<Key>(arch) || arch.entities.empty()) continue;
+            auto* keys = arch.getOrCreateComponentArray<Key, ComponentManager>();
+            ECS_PROFILE_ARCHETYPE(zone, arch.entities.size());
+
+            // Route all rows first, reading the keys chunk by chunk
+            leaving.clear();
+            size_t count = arch.entities.size();
+            for (size_t c = 0, first = 0; first < count; ++c, first += detail::chunkCapacity) {
+                const Key* data = detail::chunkData<const Key>(keys, c);
+                size_t rows = std::min(detail::chunkCapacity, count - first);
+                for (size_t i = 0; i < rows; ++i) {
+                    size_t target = route(data[i]);
+                    if (target < out.size()) leaving.emplace_back(first + i, target);
+                }
+            }
+            if (leaving.empty()) continue;
+
+            // Then take them from the back, so a swap-remove only moves a staying row
+            std::vector<detail::Archetype*> batches(out.size(), nullptr);
+            for (auto it = leaving.rbegin(); it != leaving.rend(); ++it) {
+                auto [row, target] = *it;
+                if (!batches[target]) batches[target] = &out[target].archetype(arch.signature);
+                takeRow(arch, row, *batches[target], out[target].sparseSets);
+            }
+            taken += leaving.size();
+            // Per archetype, so refs see the rows taken so far if a later route throws
+            ++structuralVersion;
+        }
+        return taken;
+    }
+
+    // Moves all entities of rows, which came from World::takeRows of any world with the same
+    // ComponentManager, into this world and leaves rows empty. The entities keep their ids, which
+    // must not exist here (worlds sharing an IdAllocator hand out distinct ids). Raises OnAdd and
+    // OnSet like createEntity.
+    void insertRows(EntityRows& rows) {
+        ECS_PROFILE_ZONE(zone, "World::insertRows");
+        for (size_t id = 0; id < rows.sparseSets.size(); ++id) {
+            auto& source = rows.sparseSets[id];
+            if (!source || source->size() == 0) continue;
+            if (id >= sparseSets.size()) sparseSets.resize(id + 1);
+            if (!sparseSets[id]) sparseSets[id] = source->createEmpty();
+            source->moveAllTo(*sparseSets[id]);
+        }
+        for (auto& batch : rows.archetypes) {
+            if (batch.entities.empty()) continue;
+            detail::Archetype* target = getOrCreateArchetype(batch.signature);
+            size_t first = appendRows(batch, *target);
+            size_t count = target->entities.size() - first;
+            ECS_PROFILE_ARCHETYPE(zone, count);
+            notifyChanged(*target, first, count, 0, batch.signature);
+        }
+    }
+
+    // Returns whether the entity exists in this world.
+    bool contains(EntityId entityId) const { return entityLocations.find(entityId) != nullptr; }
+
+    int getEntityCount() { return entityLocations.size(); }
+
+    // Number of entities that have at least the given components, i.e. the rows forEach visits.
+    template <typename... Components>
+    size_t count() const {
+        if constexpr (ComponentManager::template HasSparse<Components...>()) {
+            return countJoined<Components...>();
+        } else {
+            detail::ArchetypeSignature query =
+                (ComponentManager::template GetComponentMask<std::decay_t<Components>>() | ...);
+            size_t total = 0;
+            for (const auto& arch : archetypes) {
+                if (detail::matchArchetypeSignatures(arch.signature, query)) {
+                    total += arch.entities.size();
+                }
+            }
+            return total;
+        }
+    }
+
+    // Returns memory that is no longer needed, e.g. after a mass destruction.
+    // Removes empty archetypes, shrinks the chunk tables and the partly filled last chunk of every
+    // column and trims the entity index. Chunks never need merging, rows stay dense because every
+    // removal swaps in the last row.
+    // With a budget, the pass stops after the archetype that exceeded it and the next call
+    // continues there, so it can run a little every frame. Returns true once a pass completed.
+    bool compact(std::chrono::nanoseconds budget = std::chrono::nanoseconds::max()) {
+        ECS_PROFILE_SCOPE("World::compact");
+        auto start = std::chrono::steady_clock::now();
+        while (compactCursor < archetypes.size()) {
+            auto& arch = archetypes[compactCursor];
+            if (arch.entities.empty()) {
+                // Locations store the signature, no entity points at an empty archetype. Its
+                // columns hold no chunks, so no cached address is lost.
+                archetypes.erase(archetypes.begin() + compactCursor);
+            } else {
+                // Shrinking the last chunks moves their rows in memory
+                if (arch.shrinkToFit()) ++structuralVersion;
+                ++compactCursor;
+            }
+            if (std::chrono::steady_clock::now() - start >= budget) return false;
+        }
+        archetypes.shrink_to_fit();
+        entityLocations.shrinkToFit();
+        compactCursor = 0;
+        return true;
+    }
+
+    // Sorts the rows of every archetype with the component Key by comp(const Key&, const Key&),
+    // so entities with close keys (e.g. neighbours in space) are close in memory. All columns are
+    // permuted together and the entity locations are updated.
+    template <typename Key, typename Compare = std::less<Key>>
+    void sortArchetype(Compare comp = Compare{}) {
+        static_assert(!ComponentManager::template HasSparse<Key>(),
+                      "Sparse components are not supported here");
+        ECS_PROFILE_SCOPE("World::sortArchetype");
+        for (auto& arch : archetypes) {
+            if (!hasComponent<Key>(arch)) continue;
+            sortRows<Key>(arch, 0, arch.entities.size(), comp);
+        }
+    }
+
+    // Incremental sortArchetype, sorts at most maxSteps pairs of neighbouring chunks per archetype
+    // and call. Consecutive calls run an odd-even transposition sort over the chunks: a chunk
+    // pair is sorted as one range, then the pairs shift by one chunk. The rows are fully sorted
+    // after about as many passes as there are chunks and stay sorted in between structural
+    // changes. A pair that is already in order is not written.
+    template <typename Key, typename Compare = std::less<Key>>
+    void sortArchetypeIncremental(size_t maxSteps, Compare comp = Compare{}) {
+        static_assert(!ComponentManager::template HasSparse<Key>(),
+                      "Sparse components are not supported here");
+        ECS_PROFILE_SCOPE("World::sortArchetypeIncremental");
+        for (auto& arch : archetypes) {
+            if (!hasComponent<Key>(arch)) continue;
+            size_t count = arch.entities.size();
+            size_t chunkCount = (count + detail::chunkCapacity - 1) / detail::chunkCapacity;
+            if (chunkCount <= 2) {
+                sortRows<Key>(arch, 0, count, comp);
+                continue;
+            }
+            size_t& chunk = sortCursors[arch.signature];
+            for (size_t step = 0; step < maxSteps; ++step) {
+                // end of a pass, the next pass starts at the other parity
+                if (chunk + 1 >= chunkCount) chunk = chunk % 2 == 0 ? 1 : 0;
+                size_t first = chunk * detail::chunkCapacity;
+                size_t last = std::min(first + 2 * detail::chunkCapacity, count);
+                sortRows<Key>(arch, first, last, comp);
+                chunk += 2;
+            }
+        }
+    }
+
+    // Reports the memory of every archetype and column and of every sparse set plus the world
+    // totals. Costs O(archetypes + chunks + sparse index pages), it can be called every frame.
+    WorldStats stats() const {
+        WorldStats result;
+        result.entities = entityLocations.size();
+        result.indexPages = entityLocations.pageCount();
+        result.indexBytes = entityLocations.bytes();
+        result.indexBytesShared = entityLocations.sharedBytes();
+        for (const auto& arch : archetypes) {
+            ArchetypeStats archStats;
+            archStats.signature = arch.signature;
+            archStats.rows = arch.entities.size();
+            archStats.entities = arch.entities.stats();
+            for (const auto& [id, array] : arch.componentData) {
+                archStats.columns.push_back(array->stats());
+                archStats.columns.back().component = id;
+            }
+            std::sort(archStats.columns.begin(), archStats.columns.end(),
+                      [](const auto& a, const auto& b) { return a.component < b.component; });
+            result.archetypes.push_back(std::move(archStats));
+        }
+        for (size_t id = 0; id < sparseSets.size(); ++id) {
+            if (!sparseSets[id]) continue;
+            result.sparseSets.push_back(sparseSets[id]->stats());
+            result.sparseSets.back().component = id;
+        }
+        return result;
+    }
+
+    // Fills out with the columns of the components in it, reusing its memory. See Snapshot.
+    template <typename... Components>
+    void snapshot(Snapshot<ComponentManager, Components...>& out) const {
+        static_assert(!ComponentManager::template HasSparse<Components...>(),
+                      "Sparse components are not supported here");
+        ECS_PROFILE_SCOPE("World::snapshot");
+        // Writes through cached addresses would reach the shared chunks, as after clone
+        chunkVersion.increment();
+        detail::ArchetypeSignature selected =
+            (ComponentManager::template GetComponentMask<Components>() | ...);
+        size_t used = 0;
+        for (const auto& arch : archetypes) {
+            if ((arch.signature & selected) == 0 || arch.entities.empty()) continue;
+            if (used == out.parts.size()) out.parts.emplace_back();
+            auto& part = out.parts[used++];
+            part.signature = arch.signature & selected;
+            part.rows = arch.entities.size();
+            auto copyColumn = [&]<typename T>(detail::Column<T>& column) {
+                auto it = arch.componentData.find(ComponentManager::template GetComponentID<T>());
+                if (hasComponent<T>(arch) && it != arch.componentData.end()) {
+                    column = static_cast<const detail::ComponentArray<T>*>(it->second.get())->data;
+                } else {
+                    column = detail::Column<T>{};
+                }
+            };
+            std::apply([&](auto&... columns) { (copyColumn(columns), ...); }, part.columns);
+        }
+        out.parts.resize(used);
     }
 
-    int getEntityCount() { return entityLocationMap.size(); }
+    // Creates a copy of the world, e.g. for speculative simulation or rollback.
+    // Column chunks and entity index pages are shared copy-on-write: cloning only copies pointers
+    // (O(archetypes + chunks)) and a chunk is duplicated when either world writes to it.
+    World clone() const {
+        ECS_PROFILE_SCOPE("World::clone");
+        // Writes through cached addresses would reach the shared chunks
+        chunkVersion.increment();
+        World copy;
+        copy.archetypes.reserve(archetypes.size());
+        for (const auto& arch : archetypes) copy.archetypes.push_back(arch.clone());
+        copy.entityLocations = entityLocations;
+        copy.nextEntityId = nextEntityId;
+        copy.idAllocator = idAllocator;
+        copy.ownIdAllocator = ownIdAllocator;
+        copy.idBlockEnd = idBlockEnd;
+        copy.dynamicComponents = dynamicComponents;
+        copy.sparseSets.resize(sparseSets.size());
+        for (size_t id = 0; id < sparseSets.size(); ++id) {
+            if (sparseSets[id]) copy.sparseSets[id] = sparseSets[id]->clone();
+        }
+        return copy;
+    }
 
    private:
     // All archetypes in the world
     std::vector<detail::Archetype> archetypes{};
-    // Map of entity ID to their location
-    std::unordered_map<EntityId, detail::EntityLocation> entityLocationMap{};
+    // Maps entity ID to their location
+    detail::EntityIndex entityLocations{};
+    // Next free EntityId of this world
+    EntityId nextEntityId = 0;
+    // Shared id space of the world, with the end of the reserved block, see IdAllocator
+    IdAllocator* idAllocator = nullptr;
+    EntityId idBlockEnd = 0;
+    // Set by spawner if the world had no IdAllocator, shared with clones
+    std::shared_ptr<IdAllocator> ownIdAllocator{};
+    // Created by spawner, not copied by clone
+    std::vector<std::unique_ptr<Spawner<ComponentManager>>> spawners{};
+    // Changes whenever rows move, also in memory only, invalidating the cache of EntityRef
+    uint64_t structuralVersion = 0;
+    // Changes whenever chunks move or become shared without rows moving (relocateChunks, clone,
+    // snapshot), which may run on several threads at once. Invalidates the cache of EntityRef as
+    // well.
+    mutable detail::AtomicCounter chunkVersion{};
+    // Archetype at which an incremental compact continues
+    size_t compactCursor = 0;
+    // Buffers of applyBatch, kept for the next call
+    std::vector<std::pair<size_t, size_t>> batchLocations{};
+    std::vector<size_t> batchRows{};
+    // Chunk at which sortArchetypeIncremental continues, per archetype
+    std::unordered_map<detail::ArchetypeSignature, size_t> sortCursors{};
+    // Registered by observe, not copied by clone
+    std::vector<std::unique_ptr<detail::IObserver>> observers{};
+    // Registered by registerComponent, ids follow the ComponentList
+    std::vector<std::shared_ptr<const ComponentInfo>> dynamicComponents{};
+    static constexpr size_t staticComponentCount =
+        std::tuple_size_v<typename ComponentManager::ComponentList>;
+    // Signature bits of the ComponentList
+    static constexpr detail::ArchetypeSignature staticMask =
+        (detail::ArchetypeSignature{1} << staticComponentCount) - 1;
+    // Storage of the sparse components by component id, created with their first member
+    std::vector<std::unique_ptr<detail::ISparseSet>> sparseSets{};
     // EntityId generator
     EntityId generateEntityId() {
-        static int nextEntityId = 0;  // TODO: global static, not per instance!
+        if (idAllocator && nextEntityId == idBlockEnd) {
+            nextEntityId = idAllocator->reserve(IdAllocator::blockSize);
+            idBlockEnd = nextEntityId + IdAllocator::blockSize;
+        }
         return nextEntityId++;
     }
+    // Returns the location of an existing entity.
+    detail::EntityLocation locate(EntityId entityId) const {
+        const detail::EntityLocation* location = entityLocations.find(entityId);
+        if (!location) throw std::out_of_range("Entity not found.");
+        return *location;
+    }
+    template <typename T>
+    static bool hasComponent(const detail::Archetype& arch) {
+        return detail::matchArchetypeSignatures(
+            arch.signature, ComponentManager::template GetComponentMask<T>());
+    }
+    // Sorts the rows [first, last) of the archetype by their Key component.
+    template <typename Key, typename Compare>
+    void sortRows(detail::Archetype& arch, size_t first, size_t last, Compare& comp) {
+        const auto* keys = arch.getOrCreateComponentArray<Key, ComponentManager>();
+        std::vector<size_t> order(last - first);
+        std::iota(order.begin(), order.end(), size_t{0});
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return comp(keys->get(first + a), keys->get(first + b));
+        });
+        // Already in order, leave the chunks untouched (and shared with clones).
+        if (std::is_sorted(order.begin(), order.end())) return;
+
+        ++structuralVersion;
+        arch.entities.permute(first, order);
+        for (auto& [id, array] : arch.componentData) array->permute(first, order);
+        for (size_t i = first; i < last; ++i) {
+            entityLocations.set(std::as_const(arch.entities)[i], {arch.signature, i});
+        }
+    }
+    // Records OnAdd and OnSet for the rows [first, first + count) of arch, which had the
+    // signature before and got values for the written components.
+    void notifyChanged(detail::Archetype& arch, size_t first, size_t count,
+                       detail::ArchetypeSignature before, detail::ArchetypeSignature written) {
+        for (auto& observer : observers) {
+            if (!detail::matchArchetypeSignatures(arch.signature, observer->query)) continue;
+            bool added = !detail::matchArchetypeSignatures(before, observer->query);
+            bool set = (observer->query & written) != 0;
+            if ((observer->event == ObserverEvent::OnAdd && added) ||
+                (observer->event == ObserverEvent::OnSet && set)) {
+                observer->record(arch, first, count);
+            }
+        }
+    }
+    // Records OnRemove for the rows [first, first + count) of arch, which get the signature after.
+    // Called while the rows still hold their components.
+    void notifyRemoved(detail::Archetype& arch, size_t first, size_t count,
+                       detail::ArchetypeSignature after) {
+        for (auto& observer : observers) {
+            if (observer->event != ObserverEvent::OnRemove) continue;
+            if (!detail::matchArchetypeSignatures(arch.signature, observer->query)) continue;
+            if (detail::matchArchetypeSignatures(after, observer->query)) continue;
+            observer->record(arch, first, count);
+        }
+    }
+    // Binds a system of forEachFused to the columns of arch, inactive if arch does not match.
+    template <typename Func, typename... Components>
+    static detail::BoundSystem<Func, Components...> bindSystem(
+        detail::Archetype& arch, System<Func, Components...>& system) {
+        static_assert(!ComponentManager::template HasSparse<Components...>(),
+                      "Sparse components are not supported here");
+        detail::BoundSystem<Func, Components...> bound{&system.func};
+        detail::ArchetypeSignature query =
+            (ComponentManager::template GetComponentMask<std::decay_t<Components>>() | ...);
+        if (detail::matchArchetypeSignatures(arch.signature, query)) {
+            bound.arrays = std::make_tuple(
+                arch.getOrCreateComponentArray<std::decay_t<Components>, ComponentManager>()...);
+        }
+        return bound;
+    }
+    // Signatures of the non-empty archetypes matching query that have none of the excluded
+    // components. Collected up front, since the bulk moves create archetypes.
+    std::vector<detail::ArchetypeSignature> bulkSources(detail::ArchetypeSignature query,
+                                                        detail::ArchetypeSignature excluded) {
+        std::vector<detail::ArchetypeSignature> result;
+        for (const auto& arch : archetypes) {
+            if (arch.entities.empty()) continue;
+            if (!detail::matchArchetypeSignatures(arch.signature, query)) continue;
+            if ((arch.signature & excluded) != 0) continue;
+            result.push_back(arch.signature);
+        }
+        return result;
+    }
+    // Moves all rows of the archetype `from` to the end of the archetype `to`, see appendRows.
+    size_t moveAllRows(detail::ArchetypeSignature from, detail::ArchetypeSignature to) {
+        // Create the target first, creating it may move the source in memory
+        detail::Archetype* target = getOrCreateArchetype(to);
+        detail::Archetype* source = getOrCreateArchetype(from);
+        return appendRows(*source, *target);
+    }
+    // Appends all rows of source to target one column at a time and leaves source empty.
+    // Columns of components that target does not have are dropped. Returns the first appended
+    // row in target.
+    size_t appendRows(detail::Archetype& source, detail::Archetype& target) {
+        size_t first = target.entities.size();
+        // The last chunk of target may grow, moving its rows in memory
+        if (!source.entities.empty()) ++structuralVersion;
+
+        size_t row = first;
+        for (size_t c = 0; c < source.entities.chunks.size(); ++c) {
+            for (EntityId id : source.entities.chunk(c)) {
+                entityLocations.set(id, {target.signature, row++});
+            }
+        }
+        for (auto& [id, array] : source.componentData) {
+            if ((target.signature & (detail::ArchetypeSignature{1} << id)) == 0) {
+                array = array->createEmpty();
+                continue;
+            }
+            auto& column = target.componentData[id];
+            if (!column) column = array->createEmpty();
+            column->appendFrom(array.get());
+        }
+        target.entities.append(std::move(source.entities));
+        return first;
+    }
+    // Moves row index of arch with all components to the end of batch, and its sparse components
+    // into sparse, swap-removing it from arch like destroyEntity.
+    void takeRow(detail::Archetype& arch, size_t index, detail::Archetype& batch,
+                 std::vector<std::unique_ptr<detail::ISparseSet>>& sparse) {
+        notifyRemoved(arch, index, 1, 0);
+        size_t lastIndex = arch.entities.size() - 1;
+        EntityId entityId = std::as_const(arch.entities)[index];
+        batch.entities.push_back(entityId);
+        for (auto& [id, array] : arch.componentData) {
+            auto& column = batch.componentData[id];
+            if (!column) column = array->createEmpty();
+            column->copyElementFrom(array.get(), index);
+            if (index != lastIndex) array->moveElement(lastIndex, index);
+            array->removeLast();
+        }
+        if (index != lastIndex) {
+            std::swap(arch.entities[lastIndex], arch.entities[index]);
+            EntityId swapId = arch.entities[index];
+            entityLocations.set(swapId, detail::EntityLocation{arch.signature, index});
+        }
+        arch.entities.pop_back();
+        for (size_t id = 0; id < sparseSets.size(); ++id) {
+            if (!sparseSets[id] || !sparseSets[id]->contains(entityId)) continue;
+            if (id >= sparse.size()) sparse.resize(id + 1);
+            if (!sparse[id]) sparse[id] = sparseSets[id]->createEmpty();
+            sparseSets[id]->moveTo(entityId, *sparse[id]);
+        }
+        entityLocations.erase(entityId);
+    }
+    // Moves the entity with the components newSignature keeps to the end of the archetype of
+    // newSignature and swap-removes it from its archetype, like addComponent. Columns of added
+    // components are left to the caller. Returns the new row.
+    size_t moveRow(EntityId entityId, detail::EntityLocation location,
+                   detail::ArchetypeSignature newSignature) {
+        // Create the new archetype first, creating it may move the old one in memory
+        detail::Archetype* newArch = getOrCreateArchetype(newSignature);
+        detail::Archetype* oldArch = getOrCreateArchetype(location.signature);
+        size_t oldIndex = location.indexInArchetype;
+        size_t lastIndex = oldArch->entities.size() - 1;
+
+        newArch->entities.push_back(entityId);
+        size_t newIndex = newArch->entities.size() - 1;
+        for (auto& [id, array] : oldArch->componentData) {
+            if ((newSignature & (detail::ArchetypeSignature{1} << id)) != 0) {
+                auto& column = newArch->componentData[id];
+                if (!column) column = array->createEmpty();
+                column->copyElementFrom(array.get(), oldIndex);
+            }
+            if (oldIndex != lastIndex) array->moveElement(lastIndex, oldIndex);
+            array->removeLast();
+        }
+
+        entityLocations.set(entityId, {newSignature, newIndex});
+        ++structuralVersion;
+
+        if (oldIndex != lastIndex) {
+            std::swap(oldArch->entities[lastIndex], oldArch->entities[oldIndex]);
+            EntityId swapId = oldArch->entities[oldIndex];
+            entityLocations.set(swapId, detail::EntityLocation{oldArch->signature, oldIndex});
+        }
+        oldArch->entities.pop_back();
+        return newIndex;
+    }
+    // The sparse set of T, created with its first member.
+    template <typename T>
+    detail::SparseSet<T>& sparseSet() {
+        size_t id = ComponentManager::template GetComponentID<T>();
+        if (id >= sparseSets.size()) sparseSets.resize(id + 1);
+        if (!sparseSets[id]) sparseSets[id] = std::make_unique<detail::SparseSet<T>>();
+        return static_cast<detail::SparseSet<T>&>(*sparseSets[id]);
+    }
+    // The sparse set of T, null if T is stored in tables or no entity had it yet.
+    template <typename T>
+    detail::SparseSet<std::decay_t<T>>* findSparseSet() const {
+        using Component = std::decay_t<T>;
+        if constexpr (ComponentManager::template IsSparse<Component>()) {
+            size_t id = ComponentManager::template GetComponentID<Component>();
+            if (id < sparseSets.size()) {
+                return static_cast<detail::SparseSet<Component>*>(sparseSets[id].get());
+            }
+        }
+        return nullptr;
+    }
+    // The sparse component T of the entity, null if it has none.
+    template <typename T>
+    T* findSparse(EntityId entityId) const {
+        auto* set = findSparseSet<T>();
+        return set ? set->find(entityId) : nullptr;
+    }
+    // Stores a component of the entity in row arch.entities.size() - 1, a sparse one in its set.
+    // Returns true if other rows of the column moved in memory.
+    template <typename T, typename U>
+    bool store(detail::Archetype& arch, EntityId entityId, U&& value) {
+        using Component = std::decay_t<T>;
+        if constexpr (ComponentManager::template IsSparse<Component>()) {
+            sparseSet<Component>().insert(entityId, std::forward<U>(value));
+            return false;
+        } else {
+            return arch.getOrCreateComponentArray<Component, ComponentManager>()->push_back(
+                std::forward<U>(value));
+        }
+    }
+    // Stores a sparse component of the entity, ignores table components.
+    template <typename T, typename U>
+    void storeSparse(EntityId entityId, U&& value) {
+        using Component = std::decay_t<T>;
+        if constexpr (ComponentManager::template IsSparse<Component>()) {
+            sparseSet<Component>().insert(entityId, std::forward<U>(value));
+        }
+    }
+    // Removes a sparse component of the entity, ignores table components.
+    template <typename T>
+    void eraseSparse(EntityId entityId) {
+        if (auto* set = findSparseSet<T>()) set->erase(entityId);
+    }
+    // Removes all sparse components of the entity.
+    void eraseSparse(EntityId entityId) {
+        for (auto& set : sparseSets) {
+            if (set) set->erase(entityId);
+        }
+    }
+    // Component T of the entity in row of arch, a sparse one is looked up in its set. Throws if
+    // the entity has no sparse T.
+    template <typename T>
+    T& componentOf(detail::Archetype& arch, size_t row, EntityId entityId) {
+        using Component = std::decay_t<T>;
+        if constexpr (ComponentManager::template IsSparse<Component>()) {
+            Component* component = findSparse<Component>(entityId);
+            if (!component)
+                throw std::runtime_error("Entity does not contain the given Component.");
+            return *component;
+        } else {
+            return detail::element<T>(arch.getOrCreateComponentArray<Component, ComponentManager>(),
+                                      row);
+        }
+    }
+    // The smallest sparse set of the query, null if one of them is missing (then no entity
+    // matches).
+    template <typename... Components>
+    const detail::ISparseSet* smallestSparseSet() const {
+        const detail::ISparseSet* smallest = nullptr;
+        bool missing = false;
+        auto visit = [&]<typename T>() {
+            if constexpr (ComponentManager::template IsSparse<std::decay_t<T>>()) {
+                const detail::ISparseSet* set = findSparseSet<T>();
+                if (!set) missing = true;
+                else if (!smallest || set->size() < smallest->size()) smallest = set;
+            }
+        };
+        (visit.template operator()<Components>(), ...);
+        return missing ? nullptr : smallest;
+    }
+    // Whether the entity is in the set of T, true for a table component. sets holds the sparse
+    // set of each component of the query, null for table components.
+    template <typename T, typename Sets>
+    static bool inSparseSet(const Sets& sets, EntityId entityId) {
+        using Component = std::decay_t<T>;
+        if constexpr (ComponentManager::template IsSparse<Component>()) {
+            return std::get<detail::SparseSet<Component>*>(sets)->contains(entityId);
+        } else {
+            return true;
+        }
+    }
+    // Component T of a joined row: from its sparse set or from the table columns of the row.
+    template <typename T, typename Sets, typename Columns>
+    static T& joinedComponent(const Sets& sets, const Columns& columns, size_t row,
+                              EntityId entityId) {
+        using Component = std::decay_t<T>;
+        if constexpr (ComponentManager::template IsSparse<Component>()) {
+            return *std::get<detail::SparseSet<Component>*>(sets)->find(entityId);
+        } else {
+            return detail::element<T>(std::get<detail::ComponentArray<Component>*>(columns), row);
+        }
+    }
+    // The column of T in arch, null for a sparse component.
+    template <typename T>
+    static detail::ComponentArray<std::decay_t<T>>* tableColumn(detail::Archetype& arch) {
+        using Component = std::decay_t<T>;
+        if constexpr (ComponentManager::template IsSparse<Component>()) {
+            return nullptr;
+        } else {
+            return arch.getOrCreateComponentArray<Component, ComponentManager>();
+        }
+    }
+    // forEach of a query with sparse components, a join of the archetypes matching the table
+    // components with the sparse sets. If the smallest sparse set has fewer members than the
+    // matching archetypes have rows, it drives: each member is located in the entity index and
+    // checked against the other sets, the columns are resolved once per run of members in the
+    // same archetype. Otherwise the archetypes are walked as in forEach and every row is looked up
+    // in the sparse sets. No component is moved.
+    template <typename... Components, typename Func>
+    void forEachJoined(Func& func) {
+        ECS_PROFILE_ZONE(zone, "World::forEach");
+        const detail::ISparseSet* driver = smallestSparseSet<Components...>();
+        if (!driver || driver->size() == 0) return;
+        detail::ArchetypeSignature query = ComponentManager::template GetTableMask<Components...>();
+        auto sets = std::make_tuple(findSparseSet<Components>()...);
+        std::tuple<detail::ComponentArray<std::decay_t<Components>>*...> columns{};
+
+        size_t tableRows = 0;
+        for (const auto& arch : archetypes) {
+            if (detail::matchArchetypeSignatures(arch.signature, query)) {
+                tableRows += arch.entities.size();
+            }
+        }
+
+        if (driver->size() <= tableRows) {
+            const detail::Archetype* current = nullptr;
+            // Rows visited in the current run, the profiler counts a run as an archetype
+            [[maybe_unused]] size_t runRows = 0;
+            for (EntityId entityId : driver->entities()) {
+                if (!(inSparseSet<Components>(sets, entityId) && ...)) continue;
+                const detail::EntityLocation* location = entityLocations.find(entityId);
+                if (!detail::matchArchetypeSignatures(location->signature, query)) continue;
+                if (!current || current->signature != location->signature) {
+                    if (current) {
+                        ECS_PROFILE_ARCHETYPE(zone, runRows);
+                    }
+                    detail::Archetype* arch = getOrCreateArchetype(location->signature);
+                    columns = std::make_tuple(tableColumn<Components>(*arch)...);
+                    current = arch;
+                    runRows = 0;
+                }
+                size_t row = location->indexInArchetype;
+                func(joinedComponent<Components>(sets, columns, row, entityId)...);
+                ++runRows;
+            }
+            if (current) {
+                ECS_PROFILE_ARCHETYPE(zone, runRows);
+            }
+            return;
+        }
+
+        for (auto& arch : archetypes) {
+            if (!detail::matchArchetypeSignatures(arch.signature, query)) continue;
+            if (arch.entities.empty()) continue;
+            columns = std::make_tuple(tableColumn<Components>(arch)...);
+            size_t count = arch.entities.size();
+            ECS_PROFILE_ARCHETYPE(zone, count);
+            for (size_t row = 0; row < count; ++row) {
+                EntityId entityId = std::as_const(arch.entities)[row];
+                if (!(inSparseSet<Components>(sets, entityId) && ...)) continue;
+                func(joinedComponent<Components>(sets, columns, row, entityId)...);
+            }
+        }
+    }
+    // count of a query with sparse components, driven by the smallest sparse set.
+    template <typename... Components>
+    size_t countJoined() const {
+        const detail::ISparseSet* driver = smallestSparseSet<Components...>();
+        if (!driver) return 0;
+        detail::ArchetypeSignature query = ComponentManager::template GetTableMask<Components...>();
+        auto sets = std::make_tuple(findSparseSet<Components>()...);
+        size_t total = 0;
+        for (EntityId entityId : driver->entities()) {
+            if (!(inSparseSet<Components>(sets, entityId) && ...)) continue;
+            const detail::EntityLocation* location = entityLocations.find(entityId);
+            if (detail::matchArchetypeSignatures(location->signature, query)) ++total;
+        }
+        return total;
+    }
+    // Returns the column of a runtime component in arch, created if missing.
+    detail::ByteArray* byteArray(detail::Archetype& arch, DynamicComponent component) {
+        auto& column = arch.componentData[component.id];
+        if (!column) {
+            column = std::make_unique<detail::ByteArray>(
+                dynamicComponents.at(component.id - staticComponentCount));
+        }
+        return static_cast<detail::ByteArray*>(column.get());
+    }
     // Retrieves or creates an archetype based on the signature.
     detail::Archetype* getOrCreateArchetype(const detail::ArchetypeSignature& sig) {
         // Check if an Archetype exists for the given signature.
@@ -354,4 +3098,41 @@ class World {
         return &archetypes.back();
     }
 };
-}  // namespace ecs
\ No newline at end of file
+
+// Hands snapshots from the simulation thread to a render thread without locks (triple
+// buffering): publish fills a free slot and makes it the latest, acquire switches to the latest
+// published slot. Neither side ever waits and the render thread never sees a half written
+// snapshot.
+// All chunk references are dropped on the publishing thread, when publish refills a slot the
+// reader gave back. So the world only shares chunks with slots the reader may be reading, and it
+// copies them before writing.
+template <typename ComponentManager, typename... Components>
+class SnapshotBuffer {
+   public:
+    // Simulation thread: takes the snapshot at the end of a tick, while the world is not written.
+    void publish(const World<ComponentManager>& world) {
+        world.snapshot(slots[back]);
+        back = latest.exchange(back | fresh, std::memory_order_acq_rel) & ~fresh;
+    }
+
+    // Render thread: returns the latest published snapshot, or the previous one if nothing was
+    // published since. It stays valid until the next acquire. Do not copy it on this thread.
+    const Snapshot<ComponentManager, Components...>& acquire() {
+        if (latest.load(std::memory_order_relaxed) & fresh) {
+            front = latest.exchange(front, std::memory_order_acq_rel) & ~fresh;
+        }
+        return slots[front];
+    }
+
+   private:
+    // Marks a slot index in latest that the reader has not acquired yet.
+    static constexpr unsigned fresh = 4;
+
+    std::array<Snapshot<ComponentManager, Components...>, 3> slots;
+    std::atomic<unsigned> latest{1};
+    // Slot only the publisher uses
+    unsigned back = 0;
+    // Slot only the reader uses
+    unsigned front = 2;
+};
+}  // namespace ecs
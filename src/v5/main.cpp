@@ -1,5 +1,6 @@
 #include <array>
 #include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <random>
 
@@ -21,6 +22,11 @@ double getRandom() { return (static_cast<double>(rand() % 1000 + 1)) / 100.0; }
 
 const size_t entity_count = 1000;
 const int tick_amount = 1000;
+const size_t clone_entity_count = 100000;
+
+// Bytes a world does not share with a clone: its chunk tables and the chunks and index pages
+// only it holds.
+size_t ownedBytes(const ecs::WorldStats& stats) { return stats.bytesTotal() - stats.bytesShared(); }
 
 void mainEcs() {
     using MyECS = ecs::ComponentManager<MyECSConfig>;
@@ -53,6 +59,50 @@ void mainEcs() {
               << std::chrono::duration_cast<std::chrono::microseconds>(time).count() << std::endl;
 }
 
+void mainClone() {
+    using MyECS = ecs::ComponentManager<MyECSConfig>;
+    ecs::World<MyECS> world;
+    for (size_t i = 0; i < clone_entity_count; i++) {
+        world.createEntity<Coordinates, Velocity>(Coordinates{getRandom(), getRandom()},
+                                                  Velocity{getRandom(), getRandom()});
+    }
+
+    // fork the world
+    auto startTime = std::chrono::high_resolution_clock::now();
+    auto fork = world.clone();
+    auto endTime = std::chrono::high_resolution_clock::now();
+    size_t forkBytes = ownedBytes(fork.stats());
+    std::cout << "clone time: "
+              << std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count()
+              << " us, clone memory: " << forkBytes << " of " << world.stats().bytesTotal()
+              << " bytes" << std::endl;
+
+    // write to 1% of the entities, only their chunks get copied
+    startTime = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < clone_entity_count / 100; i++) {
+        fork.apply<Coordinates>(static_cast<ecs::EntityId>(i), [](Coordinates& coords) {
+            coords.x += 1.0;
+        });
+    }
+    endTime = std::chrono::high_resolution_clock::now();
+    size_t copied = ownedBytes(fork.stats()) - forkBytes;
+    forkBytes += copied;
+    std::cout << "sparse write after clone: "
+              << std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count()
+              << " us, copied: " << copied << " bytes" << std::endl;
+
+    // a full tick detaches every chunk of the written columns once
+    startTime = std::chrono::high_resolution_clock::now();
+    fork.forEach<Coordinates, const Velocity>([](Coordinates& coords, const Velocity& vel) {
+        coords.x += vel.xVel;
+        coords.y += vel.yVel;
+    });
+    endTime = std::chrono::high_resolution_clock::now();
+    std::cout << "first tick after clone: "
+              << std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count()
+              << " us, copied: " << ownedBytes(fork.stats()) - forkBytes << " bytes" << std::endl;
+}
+
 class PlayerOOP {
    public:
     PlayerOOP() {
@@ -96,5 +146,6 @@ void mainOop() {
 int main() {
     mainEcs();
     mainOop();
+    mainClone();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,324 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+// Memory of the chunks of component columns.
+// By default chunks come from operator new. With ChunkMemory::hugePages they are carved out of
+// 2 MiB slabs backed by huge pages, so a large world needs a fraction of the TLB entries. There
+// is one pool of slabs per NUMA node, a chunk comes from the pool of the node the allocating
+// thread runs on. Slab pages are placed by first touch, i.e. on the node of the thread that first
+// writes them, which is the allocating one in practice. World::relocateChunks moves chunks to the
+// node of the worker that iterates them.
+//
+//   ecs::setChunkMemory(ecs::ChunkMemory::hugePages);  // before creating the world
+//
+// Huge pages are requested with MAP_HUGETLB (pages reserved in /proc/sys/vm/nr_hugepages) and,
+// where none are reserved, as transparent huge pages with madvise(MADV_HUGEPAGE). If the system
+// grants neither, slabs use normal pages; if mapping fails, chunks fall back to operator new.
+
+namespace ecs {
+
+// Where new chunks get their memory from, see setChunkMemory.
+enum class ChunkMemory {
+    // operator new
+    heap,
+    // Per NUMA node pools of 2 MiB huge page slabs
+    hugePages,
+};
+
+// What the slab pools obtained so far, e.g. to check whether huge pages were granted.
+struct ChunkMemoryStats {
+    size_t slabs = 0;
+    // Slabs backed by reserved huge pages (MAP_HUGETLB)
+    size_t hugeTlbSlabs = 0;
+    // Slabs advised to use transparent huge pages, the kernel may still use normal pages
+    size_t transparentSlabs = 0;
+    // Live allocations too large for a slab, each on slabs of its own
+    size_t largeMappings = 0;
+    // Committed memory of slabs and large allocations
+    size_t bytesMapped = 0;
+};
+
+namespace detail {
+
+// Slab pools of ChunkMemory::hugePages. All slabs are carved out of one reserved range of address
+// space (the arena), so deallocate tells slab blocks from heap blocks by their address, without a
+// lock. Freed blocks go to a free list per size class of the pool they came from, slabs are never
+// returned to the system.
+class ChunkMemoryResource {
+   public:
+    static constexpr size_t slabSize = size_t{2} << 20;
+    // Address space of the arena, pages are only committed slab by slab. None on 32 bit systems.
+    static constexpr size_t arenaSize = sizeof(void*) >= 8 ? size_t{256} << 30 : 0;
+
+    // Never destroyed, chunks of static worlds may be freed after the end of main.
+    static ChunkMemoryResource& instance() {
+        static auto* resource = new ChunkMemoryResource;
+        return *resource;
+    }
+
+    std::atomic<ChunkMemory> mode{ChunkMemory::heap};
+
+    void* allocate(size_t bytes, size_t alignment) {
+        if (mode.load(std::memory_order_relaxed) == ChunkMemory::hugePages) {
+            if (void* block = allocateMapped(bytes, alignment)) return block;
+        }
+        // The operator new std::allocator would call, so replacements of the plain one see chunks
+        if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            return ::operator new(bytes, std::align_val_t{alignment});
+        }
+        return ::operator new(bytes);
+    }
+
+    void deallocate(void* block, size_t bytes, size_t alignment) {
+        if (inArena(block)) {
+            deallocateMapped(block, bytes, alignment);
+        } else if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            ::operator delete(block, std::align_val_t{alignment});
+        } else {
+            ::operator delete(block);
+        }
+    }
+
+    ChunkMemoryStats stats() {
+        std::lock_guard<std::mutex> lock(arenaMutex);
+        return totals;
+    }
+
+   private:
+    static constexpr size_t maxNodes = 64;
+    // Size classes are the powers of two from minBlock to slabSize / 2
+    static constexpr size_t minBlock = 64;
+    static constexpr size_t classes = 15;
+    // Marks the first slab of a large block in slabInfo, the other bits hold its slab count
+    static constexpr uint32_t largeBlock = uint32_t{1} << 31;
+
+    struct Pool {
+        std::mutex mutex;
+        std::array<std::vector<void*>, classes> free;
+        std::byte* slab = nullptr;
+        size_t used = slabSize;
+    };
+
+    std::array<Pool, maxNodes> pools;
+    // Start of the arena, 0 until the first slab is needed. Written once.
+    std::atomic<uintptr_t> arenaBegin{0};
+    // Per slab of the arena: node + 1 for slabs of a pool, largeBlock | slabs for the first slab
+    // of a large block. Written before the blocks of the slab are handed out.
+    std::unique_ptr<std::atomic<uint32_t>[]> slabInfo;
+    // Guards the members below
+    std::mutex arenaMutex;
+    // Slabs of the arena committed so far
+    size_t nextSlab = 0;
+    bool arenaFailed = false;
+    // Cleared after MAP_HUGETLB failed once, e.g. because no huge pages are reserved
+    bool hugeTlb = true;
+    // Freed large blocks, slab count -> first slab, reused before the arena grows
+    std::multimap<size_t, size_t> freeLarge;
+    ChunkMemoryStats totals;
+
+    bool inArena(const void* block) const {
+        uintptr_t begin = arenaBegin.load(std::memory_order_acquire);
+        return begin != 0 && reinterpret_cast<uintptr_t>(block) - begin < arenaSize;
+    }
+
+    size_t slabIndex(const void* block) const {
+        return (reinterpret_cast<uintptr_t>(block) - arenaBegin.load(std::memory_order_relaxed)) /
+               slabSize;
+    }
+
+    static size_t sizeClass(size_t bytes) {
+        size_t c = 0;
+        while ((minBlock << c) < bytes) ++c;
+        return c;
+    }
+
+    static size_t currentNode() {
+#if defined(__linux__) && defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+        unsigned cpu = 0, node = 0;
+        if (getcpu(&cpu, &node) == 0) return node % maxNodes;
+#endif
+        return 0;
+    }
+
+    void* allocateMapped(size_t bytes, size_t alignment) {
+        if (alignment > 4096) return nullptr;
+        if (bytes > slabSize / 2) return allocateLarge(bytes);
+        size_t c = sizeClass(std::max(bytes, alignment));
+        size_t block = minBlock << c;
+        size_t node = currentNode();
+        Pool& pool = pools[node];
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (!pool.free[c].empty()) {
+            void* result = pool.free[c].back();
+            pool.free[c].pop_back();
+            return result;
+        }
+        // Blocks are aligned to their size, at most 4 KiB, within the 2 MiB aligned slab
+        size_t align = std::min<size_t>(block, 4096);
+        size_t offset = (pool.used + align - 1) / align * align;
+        if (offset + block > slabSize) {
+            std::lock_guard<std::mutex> arenaLock(arenaMutex);
+            std::byte* slab = commit(1);
+            if (!slab) return nullptr;
+            slabInfo[slabIndex(slab)].store(uint32_t(node + 1), std::memory_order_relaxed);
+            ++totals.slabs;
+            pool.slab = slab;
+            offset = 0;
+        }
+        pool.used = offset + block;
+        return pool.slab + offset;
+    }
+
+    void* allocateLarge(size_t bytes) {
+        size_t slabs = (bytes + slabSize - 1) / slabSize;
+        std::lock_guard<std::mutex> lock(arenaMutex);
+        std::byte* block = nullptr;
+        if (auto it = freeLarge.lower_bound(slabs); it != freeLarge.end()) {
+            // A freed block keeps its slab count, a larger one is handed out whole
+            block = reinterpret_cast<std::byte*>(arenaBegin.load(std::memory_order_relaxed)) +
+                    it->second * slabSize;
+            freeLarge.erase(it);
+        } else {
+            block = commit(slabs);
+            if (!block) return nullptr;
+            slabInfo[slabIndex(block)].store(largeBlock | uint32_t(slabs),
+                                             std::memory_order_relaxed);
+        }
+        ++totals.largeMappings;
+        return block;
+    }
+
+    void deallocateMapped(void* block, size_t bytes, size_t alignment) {
+        uint32_t info = slabInfo[slabIndex(block)].load(std::memory_order_relaxed);
+        if (info & largeBlock) {
+            size_t slabs = info & ~largeBlock;
+#if defined(__linux__) && defined(MADV_DONTNEED)
+            // Gives the pages back, the range stays committed for the next large block
+            madvise(block, slabs * slabSize, MADV_DONTNEED);
+#endif
+            std::lock_guard<std::mutex> lock(arenaMutex);
+            freeLarge.emplace(slabs, slabIndex(block));
+            --totals.largeMappings;
+            return;
+        }
+        Pool& pool = pools[info - 1];
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        pool.free[sizeClass(std::max(bytes, alignment))].push_back(block);
+    }
+
+    // Commits the next `slabs` slabs of the arena, preferring reserved huge pages. Called with
+    // arenaMutex held, returns null if the arena cannot be reserved or is full.
+    std::byte* commit(size_t slabs) {
+#if defined(__linux__)
+        if (!reserveArena() || nextSlab + slabs > arenaSize / slabSize) return nullptr;
+        auto* address = reinterpret_cast<std::byte*>(arenaBegin.load(std::memory_order_relaxed)) +
+                        nextSlab * slabSize;
+        size_t length = slabs * slabSize;
+        bool hugeTlbPages = false, transparent = false;
+#if defined(MAP_HUGETLB) && defined(MREMAP_FIXED)
+        if (hugeTlb) {
+            // Reserved huge pages are mapped elsewhere and moved over the reservation, mremap
+            // replaces the range at once (mapping them there would unmap it first)
+            void* pages = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (pages != MAP_FAILED) {
+                hugeTlbPages = mremap(pages, length, length, MREMAP_MAYMOVE | MREMAP_FIXED,
+                                      address) != MAP_FAILED;
+                if (!hugeTlbPages) munmap(pages, length);
+            }
+            hugeTlb = hugeTlbPages;
+        }
+#endif
+        if (!hugeTlbPages) {
+            if (mprotect(address, length, PROT_READ | PROT_WRITE) != 0) return nullptr;
+#ifdef MADV_HUGEPAGE
+            transparent = madvise(address, length, MADV_HUGEPAGE) == 0;
+#endif
+        }
+        nextSlab += slabs;
+        totals.hugeTlbSlabs += hugeTlbPages ? slabs : 0;
+        totals.transparentSlabs += transparent ? slabs : 0;
+        totals.bytesMapped += length;
+        return address;
+#else
+        (void)slabs;
+        return nullptr;
+#endif
+    }
+
+#if defined(__linux__)
+    // Reserves the arena as inaccessible address space on first use.
+    bool reserveArena() {
+        if (arenaBegin.load(std::memory_order_relaxed) != 0) return true;
+        if (arenaFailed || arenaSize == 0) return false;
+        // Over-map by a slab and trim, mmap only aligns to the page size
+        void* raw = mmap(nullptr, arenaSize + slabSize, PROT_NONE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (raw == MAP_FAILED) {
+            arenaFailed = true;
+            return false;
+        }
+        auto begin = reinterpret_cast<uintptr_t>(raw);
+        uintptr_t base = (begin + slabSize - 1) & ~(slabSize - 1);
+        if (base > begin) munmap(raw, base - begin);
+        if (size_t tail = begin + slabSize - base; tail > 0) {
+            munmap(reinterpret_cast<void*>(base + arenaSize), tail);
+        }
+        slabInfo.reset(new std::atomic<uint32_t>[arenaSize / slabSize]());
+        arenaBegin.store(base, std::memory_order_release);
+        return true;
+    }
+#endif
+};
+
+// Allocator of the chunks of Column<T>, see ChunkMemory.
+template <typename T>
+struct ChunkAllocator {
+    using value_type = T;
+
+    ChunkAllocator() = default;
+    template <typename U>
+    ChunkAllocator(const ChunkAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(
+            ChunkMemoryResource::instance().allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* p, size_t n) {
+        ChunkMemoryResource::instance().deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    friend bool operator==(const ChunkAllocator&, const ChunkAllocator&) { return true; }
+};
+
+}  // namespace detail
+
+// Selects the memory of chunks allocated from now on, chunks keep the memory they have.
+inline void setChunkMemory(ChunkMemory memory) {
+    detail::ChunkMemoryResource::instance().mode.store(memory, std::memory_order_relaxed);
+}
+
+inline ChunkMemory chunkMemory() {
+    return detail::ChunkMemoryResource::instance().mode.load(std::memory_order_relaxed);
+}
+
+inline ChunkMemoryStats chunkMemoryStats() {
+    return detail::ChunkMemoryResource::instance().stats();
+}
+
+}  // namespace ecs
@@ -0,0 +1,216 @@
+#pragma once
+
+// Lightweight instrumentation for the ECS.
+// Zones are timed scopes, each finished zone is written into a ring buffer owned by its thread
+// (no locks, no allocation). Queries add the number of archetypes and rows they visited to the
+// zone. The buffers can be exported as Chrome trace_event JSON, which chrome://tracing and
+// Perfetto open directly.
+//
+// Everything is compiled out unless ECS_PROFILING is defined, the macros then expand to nothing.
+//
+// Usage:
+//   ECS_PROFILE_SCOPE("movement");                  // times the rest of the scope
+//   ecs::profiler::Profiler::instance().writeChromeTrace("trace.json");
+
+#ifdef ECS_PROFILING
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Number of events kept per thread, older events are overwritten.
+#ifndef ECS_PROFILER_BUFFER_SIZE
+#define ECS_PROFILER_BUFFER_SIZE 65536
+#endif
+
+namespace ecs::profiler {
+
+// A finished zone. The name is not copied, it must be a string literal.
+struct Event {
+    const char* name;
+    uint64_t start;     // ns, steady clock
+    uint64_t duration;  // ns
+    uint64_t rows;
+    uint32_t archetypes;
+    uint32_t thread;
+};
+
+inline uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Ring buffer with the events of one thread. Only the owning thread writes. After the thread
+// exited the buffer keeps its events and is handed to the next new thread.
+struct ThreadBuffer {
+    explicit ThreadBuffer(uint32_t id) : thread(id), events(ECS_PROFILER_BUFFER_SIZE) {}
+
+    void push(const Event& event) {
+        uint64_t n = written.load(std::memory_order_relaxed);
+        events[n % events.size()] = event;
+        written.store(n + 1, std::memory_order_release);
+    }
+
+    uint32_t thread;
+    std::vector<Event> events;
+    std::atomic<uint64_t> written{0};
+};
+
+// Owns the buffers of the threads that recorded a zone.
+class Profiler {
+   public:
+    static Profiler& instance() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    // Returns the buffer of the calling thread, taking one on first use. It is given back when
+    // the thread exits, so threads that come and go (std::async, parallel algorithms) reuse the
+    // buffers and there are only as many as threads recorded zones at the same time.
+    ThreadBuffer& threadBuffer() {
+        thread_local Lease lease(*this);
+        return *lease.buffer;
+    }
+
+    // Number of buffers, each ECS_PROFILER_BUFFER_SIZE events.
+    size_t bufferCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return buffers.size();
+    }
+
+    // Copies the recorded events of all threads, oldest first per thread.
+    // Zones finishing concurrently may be missed or torn, so call it between ticks.
+    std::vector<Event> collect() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<Event> result;
+        for (const auto& buffer : buffers) {
+            uint64_t written = buffer->written.load(std::memory_order_acquire);
+            uint64_t size = buffer->events.size();
+            uint64_t first = written > size ? written - size : 0;
+            for (uint64_t i = first; i < written; ++i) result.push_back(buffer->events[i % size]);
+        }
+        return result;
+    }
+
+    // Drops all recorded events. Like collect, call it while no zone is finishing.
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& buffer : buffers) buffer->written.store(0, std::memory_order_release);
+    }
+
+    // Writes all recorded events as Chrome trace_event JSON. Returns false if the file could not
+    // be written.
+    bool writeChromeTrace(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) return false;
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        for (const Event& event : collect()) {
+            if (!first) out << ',';
+            first = false;
+            out << "{\"name\":\"";
+            for (const char* c = event.name; *c; ++c) {
+                if (*c == '"' || *c == '\\') out << '\\';
+                out << *c;
+            }
+            out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+                << ",\"ts\":" << event.start / 1000 << '.' << event.start % 1000 / 100
+                << ",\"dur\":" << event.duration / 1000 << '.' << event.duration % 1000 / 100;
+            if (event.archetypes > 0) {
+                out << ",\"args\":{\"archetypes\":" << event.archetypes
+                    << ",\"rows\":" << event.rows << '}';
+            }
+            out << '}';
+        }
+        out << "]}\n";
+        return static_cast<bool>(out);
+    }
+
+   private:
+    // Holds the buffer of a thread until the thread exits.
+    struct Lease {
+        explicit Lease(Profiler& profiler) : profiler(profiler), buffer(profiler.acquire()) {}
+        ~Lease() { profiler.release(buffer); }
+
+        Profiler& profiler;
+        ThreadBuffer* buffer;
+    };
+
+    Profiler() = default;
+
+    // A released buffer if there is one, else a new one. Either way with a new thread id.
+    ThreadBuffer* acquire() {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint32_t thread = nextThread++;
+        if (idle.empty()) {
+            buffers.push_back(std::make_unique<ThreadBuffer>(thread));
+            return buffers.back().get();
+        }
+        ThreadBuffer* buffer = idle.back();
+        idle.pop_back();
+        buffer->thread = thread;
+        return buffer;
+    }
+
+    void release(ThreadBuffer* buffer) {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back(buffer);
+    }
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    // Buffers of exited threads
+    std::vector<ThreadBuffer*> idle;
+    uint32_t nextThread = 0;
+};
+
+// Times a scope and records it as one Event when the scope ends.
+class Zone {
+   public:
+    explicit Zone(const char* name) : name(name), start(now()) {}
+    ~Zone() {
+        ThreadBuffer& buffer = Profiler::instance().threadBuffer();
+        buffer.push(Event{name, start, now() - start, rows, archetypes, buffer.thread});
+    }
+
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+    // Counts one visited archetype with its rows.
+    void addArchetype(uint64_t archetypeRows) {
+        ++archetypes;
+        rows += archetypeRows;
+    }
+
+   private:
+    const char* name;
+    uint64_t start;
+    uint64_t rows = 0;
+    uint32_t archetypes = 0;
+};
+
+}  // namespace ecs::profiler
+
+#define ECS_PROFILE_CONCAT_IMPL(a, b) a##b
+#define ECS_PROFILE_CONCAT(a, b) ECS_PROFILE_CONCAT_IMPL(a, b)
+// Declares a zone named `var`, used by queries to add archetype and row counts.
+#define ECS_PROFILE_ZONE(var, name) ::ecs::profiler::Zone var(name)
+// Adds one visited archetype with `rows` rows to the zone `var`.
+#define ECS_PROFILE_ARCHETYPE(var, rows) var.addArchetype(rows)
+// Times the rest of the current scope.
+#define ECS_PROFILE_SCOPE(name) \
+    ECS_PROFILE_ZONE(ECS_PROFILE_CONCAT(ecsProfileZone, __LINE__), name)
+
+#else
+
+#define ECS_PROFILE_ZONE(var, name)
+#define ECS_PROFILE_ARCHETYPE(var, rows)
+#define ECS_PROFILE_SCOPE(name)
+
+#endif
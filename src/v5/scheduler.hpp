@@ -0,0 +1,262 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "profiler.hpp"
+#include "worker.hpp"
+
+// Coroutine systems: long running work (pathfinding batches, streaming) written as a plain loop
+// that suspends across ticks instead of a hand written state machine over forEach.
+//
+//   ecs::Task paths(ecs::Scheduler& scheduler, ecs::World<MyECS>& world) {
+//       for (size_t cursor = 0; cursor < world.count<Path>(); cursor += 256) {
+//           world.forEachInRange<Path>(cursor, cursor + 256, [](Path& path) { ... });
+//           co_await scheduler.budget(std::chrono::milliseconds(1));  // rest in the next tick
+//       }
+//   }
+//   auto handle = scheduler.spawn(paths(scheduler, world));
+//   scheduler.tick();  // once per frame
+//
+// Locals such as the cursor live in the coroutine frame and survive the suspension. Note that
+// row ranges shift when the world changes structurally between two ticks.
+
+namespace ecs {
+
+class Scheduler;
+
+namespace detail {
+
+// Completion of a system, shared by its promise and its SystemHandles. Guarded by the mutex of
+// the scheduler.
+struct TaskState {
+    bool done = false;
+    std::exception_ptr exception;
+    // Systems waiting for this one, all of them Tasks
+    std::vector<std::coroutine_handle<>> waiters;
+};
+
+}  // namespace detail
+
+// Return type of a coroutine system. Starts suspended and runs once handed to Scheduler::spawn.
+class Task {
+   public:
+    struct promise_type {
+        std::shared_ptr<detail::TaskState> state = std::make_shared<detail::TaskState>();
+        // Start of the current resumption, for Scheduler::budget
+        std::chrono::steady_clock::time_point resumedAt{};
+
+        Task get_return_object() {
+            return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { state->exception = std::current_exception(); }
+    };
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+    // A task that was never spawned is destroyed without running.
+    ~Task() {
+        if (handle) handle.destroy();
+    }
+
+   private:
+    friend class Scheduler;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Refers to a spawned system. co_await it from another system to continue once it finished.
+class SystemHandle {
+   public:
+    bool done() const;
+
+    bool await_ready() const { return false; }
+    // Only a Task may wait, the scheduler resumes the waiter as one.
+    bool await_suspend(std::coroutine_handle<Task::promise_type> waiter) const;
+    void await_resume() const {}
+
+   private:
+    friend class Scheduler;
+
+    SystemHandle(Scheduler& scheduler, std::shared_ptr<detail::TaskState> state)
+        : scheduler(&scheduler), state(std::move(state)) {}
+
+    Scheduler* scheduler;
+    std::shared_ptr<detail::TaskState> state;
+};
+
+// Runs coroutine systems, once per frame by tick. A tick resumes every system that is due: the
+// ones that awaited nextTick or ran out of budget in the last tick, and the ones whose awaited
+// system finished (in the same tick). Due systems are resumed on up to `threads` threads at
+// once: the one calling tick and threads - 1 workers the scheduler starts once and keeps, so
+// systems that run in the same tick must not write the same data.
+class Scheduler {
+   public:
+    explicit Scheduler(size_t threads = 1) : threads(threads == 0 ? 1 : threads) {
+        for (size_t t = 1; t < this->threads; ++t) {
+            workers.push_back(std::make_unique<detail::Worker>());
+        }
+    }
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    // Destroys the frames of the systems that did not finish.
+    ~Scheduler() {
+        for (void* address : live) std::coroutine_handle<>::from_address(address).destroy();
+    }
+
+    // Takes over the system, it first runs in the next tick.
+    SystemHandle spawn(Task task) {
+        auto handle = std::exchange(task.handle, {});
+        std::lock_guard<std::mutex> lock(mutex);
+        live.insert(handle.address());
+        pending.push_back(handle);
+        return SystemHandle(*this, handle.promise().state);
+    }
+
+    // Resumes the due systems until all of them suspended or finished. Rethrows the first
+    // exception a system ended with, after all due systems ran.
+    void tick() {
+        ECS_PROFILE_SCOPE("Scheduler::tick");
+        std::vector<Handle> batch;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            batch.swap(pending);
+        }
+        std::exception_ptr failure;
+        while (!batch.empty()) {
+            // Slice t of the batch goes to worker t - 1, the first one to this thread
+            size_t tasks = std::min(threads, batch.size());
+            for (size_t t = 1; t < tasks; ++t) {
+                workers[t - 1]->post([&, t, tasks] {
+                    resumeRange(batch, batch.size() * t / tasks,
+                                batch.size() * (t + 1) / tasks);
+                });
+            }
+            resumeRange(batch, 0, batch.size() / tasks);
+            for (size_t t = 1; t < tasks; ++t) {
+                std::exception_ptr error = workers[t - 1]->wait();
+                if (!failure) failure = error;
+            }
+
+            // Systems whose awaited system finished continue in this tick
+            std::lock_guard<std::mutex> lock(mutex);
+            batch.clear();
+            batch.swap(ready);
+            if (!failure) failure = std::exchange(this->failure, nullptr);
+        }
+        if (failure) std::rethrow_exception(failure);
+    }
+
+    // Number of systems that did not finish yet.
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return live.size();
+    }
+
+    // co_await scheduler.nextTick(): continue in the next tick.
+    auto nextTick() { return NextTick{this}; }
+
+    // co_await scheduler.budget(d): continue right away if the system has run for less than d
+    // since this tick resumed it, else in the next tick.
+    auto budget(std::chrono::nanoseconds duration) { return Budget{this, duration}; }
+
+   private:
+    friend class SystemHandle;
+
+    using Handle = std::coroutine_handle<Task::promise_type>;
+
+    struct NextTick {
+        Scheduler* scheduler;
+
+        bool await_ready() const { return false; }
+        void await_suspend(Handle handle) const { scheduler->defer(handle); }
+        void await_resume() const {}
+    };
+
+    struct Budget {
+        Scheduler* scheduler;
+        std::chrono::nanoseconds duration;
+
+        bool await_ready() const { return false; }
+        bool await_suspend(Handle handle) const {
+            auto elapsed = std::chrono::steady_clock::now() - handle.promise().resumedAt;
+            if (elapsed < duration) return false;
+            scheduler->defer(handle);
+            return true;
+        }
+        void await_resume() const {}
+    };
+
+    size_t threads;
+    // threads - 1 of them
+    std::vector<std::unique_ptr<detail::Worker>> workers;
+    mutable std::mutex mutex;
+    // Due in the next tick
+    std::vector<Handle> pending;
+    // Due in this tick, their awaited system finished
+    std::vector<Handle> ready;
+    // Frames of all unfinished systems
+    std::unordered_set<void*> live;
+    // First exception of a system in this tick
+    std::exception_ptr failure;
+
+    void defer(Handle handle) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(handle);
+    }
+
+    void resumeRange(const std::vector<Handle>& batch, size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            Handle handle = batch[i];
+            handle.promise().resumedAt = std::chrono::steady_clock::now();
+            handle.resume();
+            if (handle.done()) finish(handle);
+        }
+    }
+
+    // Wakes the waiters of a finished system and destroys its frame.
+    void finish(Handle handle) {
+        std::lock_guard<std::mutex> lock(mutex);
+        detail::TaskState& state = *handle.promise().state;
+        state.done = true;
+        if (state.exception && !failure) failure = state.exception;
+        for (auto waiter : state.waiters) ready.push_back(Handle::from_address(waiter.address()));
+        state.waiters.clear();
+        live.erase(handle.address());
+        handle.destroy();
+    }
+};
+
+inline bool SystemHandle::done() const {
+    std::lock_guard<std::mutex> lock(scheduler->mutex);
+    return state->done;
+}
+
+inline bool SystemHandle::await_suspend(std::coroutine_handle<Task::promise_type> waiter) const {
+    std::lock_guard<std::mutex> lock(scheduler->mutex);
+    if (state->done) return false;
+    state->waiters.push_back(waiter);
+    return true;
+}
+
+}  // namespace ecs
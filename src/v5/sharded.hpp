@@ -0,0 +1,214 @@
+#pragma once
+#include <atomic>
+#include <barrier>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "ecs.hpp"
+#include "worker.hpp"
+
+namespace ecs {
+
+namespace detail {
+
+// Unbounded lock-free queue between exactly one producer and one consumer thread. A linked list
+// whose first node is a consumed stub: the producer only touches the tail, the consumer only the
+// head, they meet at the atomic next pointer.
+template <typename T>
+class SpscQueue {
+   public:
+    SpscQueue() : head(new Node), tail(head) {}
+    ~SpscQueue() {
+        while (head) delete std::exchange(head, head->next.load(std::memory_order_relaxed));
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer thread.
+    void push(T value) {
+        Node* node = new Node{std::move(value)};
+        tail->next.store(node, std::memory_order_release);
+        tail = node;
+    }
+
+    // Consumer thread. Returns false if the queue is empty.
+    bool pop(T& out) {
+        Node* next = head->next.load(std::memory_order_acquire);
+        if (!next) return false;
+        out = std::move(next->value);
+        delete std::exchange(head, next);
+        return true;
+    }
+
+   private:
+    struct Node {
+        T value{};
+        std::atomic<Node*> next{nullptr};
+    };
+
+    // Apart, so the two threads do not share a cache line
+    alignas(64) Node* head;
+    alignas(64) Node* tail;
+};
+
+}  // namespace detail
+
+// Splits the entities over several worlds (shards), e.g. by area of the map, and updates them
+// on one thread per shard. Each shard has a worker thread of its own for the lifetime of the
+// ShardedWorld, pinned to a CPU (shard s to the s-th allowed one), so a shard's chunks stay in
+// the caches and on the NUMA node of that CPU from tick to tick. Shards share nothing but the
+// IdAllocator, so entity ids are unique across all shards and an entity keeps its id when it
+// migrates.
+// Entities migrate with all their components: each shard takes the leaving rows out of its world
+// (World::takeRows) and pushes them into a lock-free single producer single consumer queue per
+// pair of shards, the target inserts them (World::insertRows).
+// Structural changes of a shard must run on its thread (run), the rest of the world is only
+// accessed between runs.
+template <typename ComponentManager>
+class ShardedWorld {
+   public:
+    using Shard = World<ComponentManager>;
+
+    explicit ShardedWorld(size_t shardCount) {
+        if (shardCount == 0) throw std::invalid_argument("A ShardedWorld needs a shard.");
+        for (size_t s = 0; s < shardCount; ++s) {
+            lanes.push_back(std::make_unique<Lane>(ids, shardCount, s));
+        }
+    }
+
+    size_t shardCount() const { return lanes.size(); }
+
+    Shard& shard(size_t s) { return lanes[s]->world; }
+
+    template <typename... Components>
+    EntityId createEntity(size_t s, Components&&... components) {
+        return shard(s).template createEntity<Components...>(
+            std::forward<Components>(components)...);
+    }
+
+    // Calls func(shardIndex, world) for every shard in parallel, each on the worker thread of its
+    // shard, and waits for all of them. Rethrows the first exception after all calls returned.
+    template <typename Func>
+    void run(Func func) {
+        for (size_t s = 0; s < lanes.size(); ++s) {
+            lanes[s]->worker.post([&, s] { func(s, shard(s)); });
+        }
+        std::exception_ptr failure;
+        for (auto& lane : lanes) {
+            std::exception_ptr error = lane->worker.wait();
+            if (!failure) failure = error;
+        }
+        if (failure) std::rethrow_exception(failure);
+    }
+
+    // The thread that runs the shard, e.g. to find it in a profile.
+    std::thread::id threadOf(size_t s) const { return lanes[s]->worker.id(); }
+
+    // A shard-local system: World::forEach on every shard in parallel, each with its own copy
+    // of func.
+    template <typename... Components, typename Func>
+    void forEach(Func func) {
+        ECS_PROFILE_SCOPE("ShardedWorld::forEach");
+        run([&](size_t, Shard& world) { world.template forEach<Components...>(func); });
+    }
+
+    // Moves every entity with a Key component to the shard shardOf(const Key&) returns, with all
+    // its components. All shards first send their leaving entities, then wait for each other and
+    // insert what they received. Returns the number of migrated entities.
+    // If shardOf throws, the shard still sends the entities it took before and receives; migrate
+    // rethrows the first exception once all shards are done, no entity is lost.
+    template <typename Key, typename ShardOf>
+    size_t migrate(ShardOf shardOf) {
+        ECS_PROFILE_SCOPE("ShardedWorld::migrate");
+        std::barrier sent(static_cast<std::ptrdiff_t>(lanes.size()));
+        std::vector<size_t> migrated(lanes.size());
+        run([&](size_t s, Shard& world) {
+            Lane& lane = *lanes[s];
+            // The other shards wait at the barrier, so it is reached even if this one fails
+            std::exception_ptr failure;
+            try {
+                // Routing to itself (or out of range) keeps the entity
+                migrated[s] = world.template takeRows<Key>(
+                    [&](const Key& key) {
+                        size_t target = shardOf(key);
+                        return target == s ? lanes.size() : target;
+                    },
+                    std::span<EntityRows>(lane.outgoing));
+            } catch (...) {
+                failure = std::current_exception();
+            }
+            for (size_t t = 0; t < lanes.size(); ++t) {
+                if (lane.outgoing[t].empty()) continue;
+                lanes[t]->inbound[s].push(std::move(lane.outgoing[t]));
+                if (lane.spare.empty()) {
+                    lane.outgoing[t] = EntityRows{};
+                } else {
+                    lane.outgoing[t] = std::move(lane.spare.back());
+                    lane.spare.pop_back();
+                }
+            }
+
+            sent.arrive_and_wait();
+            EntityRows rows;
+            for (auto& queue : lane.inbound) {
+                while (queue.pop(rows)) {
+                    world.insertRows(rows);
+                    if (lane.spare.size() < lanes.size()) lane.spare.push_back(std::move(rows));
+                }
+            }
+            if (failure) std::rethrow_exception(failure);
+        });
+        size_t total = 0;
+        for (size_t count : migrated) total += count;
+        return total;
+    }
+
+    // Same as World::apply on the shard that has the entity, which is searched.
+    // Throws std::out_of_range if no shard has it.
+    template <typename... Components, typename Func>
+    void apply(EntityId entityId, Func func) {
+        shard(findShard(entityId)).template apply<Components...>(entityId, std::move(func));
+    }
+
+    // Returns the shard that has the entity, throws std::out_of_range if none has it.
+    size_t findShard(EntityId entityId) const {
+        for (size_t s = 0; s < lanes.size(); ++s) {
+            if (lanes[s]->world.contains(entityId)) return s;
+        }
+        throw std::out_of_range("Entity not found.");
+    }
+
+    size_t getEntityCount() {
+        size_t total = 0;
+        for (auto& lane : lanes) total += lane->world.getEntityCount();
+        return total;
+    }
+
+   private:
+    // A shard with its queues and its thread, which owns them during run.
+    struct Lane {
+        Shard world;
+        // Rows leaving for each shard, reused while empty
+        std::vector<EntityRows> outgoing;
+        // Rows arriving from each shard
+        std::vector<detail::SpscQueue<EntityRows>> inbound;
+        // Drained inbound rows, which replace the sent outgoing ones with their column objects
+        std::vector<EntityRows> spare;
+        // Last, so it is joined before the world goes
+        detail::Worker worker;
+
+        Lane(IdAllocator& ids, size_t shardCount, size_t s)
+            : world(ids), outgoing(shardCount), inbound(shardCount), worker(s) {}
+    };
+
+    IdAllocator ids;
+    std::vector<std::unique_ptr<Lane>> lanes;
+};
+
+}  // namespace ecs
@@ -0,0 +1,209 @@
+#pragma once
+#include <cstddef>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ecs {
+
+// Memory statistics of one column of an archetype, see World::stats.
+struct ColumnStats {
+    // Component id (index in the ComponentList), unused for the entity id column.
+    size_t component = 0;
+    size_t elementSize = 0;
+    size_t rows = 0;
+    size_t chunks = 0;
+    // Chunks still shared copy-on-write with a cloned world.
+    size_t sharedChunks = 0;
+    // rows * elementSize
+    size_t bytesUsed = 0;
+    // Capacity of all allocated chunks.
+    size_t bytesReserved = 0;
+    // Capacity of the shared chunks, part of bytesReserved.
+    size_t bytesShared = 0;
+    // Chunk table and chunk headers.
+    size_t bytesOverhead = 0;
+
+    // Reserved but unused bytes.
+    size_t slack() const { return bytesReserved - bytesUsed; }
+};
+
+// Memory statistics of one archetype.
+struct ArchetypeStats {
+    size_t signature = 0;
+    size_t rows = 0;
+    // The entity id of every row.
+    ColumnStats entities;
+    // One entry per component column, ordered by component id.
+    std::vector<ColumnStats> columns;
+
+    size_t bytesUsed() const { return sum(&ColumnStats::bytesUsed); }
+    size_t bytesReserved() const { return sum(&ColumnStats::bytesReserved); }
+    size_t bytesOverhead() const { return sum(&ColumnStats::bytesOverhead); }
+    size_t bytesShared() const { return sum(&ColumnStats::bytesShared); }
+    size_t slack() const { return bytesReserved() - bytesUsed(); }
+
+   private:
+    size_t sum(size_t ColumnStats::*field) const {
+        size_t total = entities.*field;
+        for (const auto& column : columns) total += column.*field;
+        return total;
+    }
+};
+
+// Memory statistics of the sparse set of one sparse component, see World::stats.
+struct SparseSetStats {
+    // Component id (index in the ComponentList).
+    size_t component = 0;
+    size_t elementSize = 0;
+    size_t members = 0;
+    // members * (elementSize + id size)
+    size_t bytesUsed = 0;
+    // Capacity of the dense values and of the dense ids.
+    size_t valueBytes = 0;
+    size_t idBytes = 0;
+    // The id -> dense position index: allocated pages and the bytes of the pages plus the page
+    // table.
+    size_t indexPages = 0;
+    size_t indexBytes = 0;
+
+    size_t bytesReserved() const { return valueBytes + idBytes; }
+    size_t slack() const { return bytesReserved() - bytesUsed; }
+};
+
+// Memory statistics of a whole world, returned by World::stats.
+struct WorldStats {
+    size_t entities = 0;
+    // Memory of the entity id -> location index.
+    size_t indexPages = 0;
+    size_t indexBytes = 0;
+    // Index pages still shared with a cloned world, part of indexBytes.
+    size_t indexBytesShared = 0;
+    std::vector<ArchetypeStats> archetypes;
+    // One entry per sparse component in use, ordered by component id.
+    std::vector<SparseSetStats> sparseSets;
+
+    size_t bytesUsed() const {
+        size_t total = sum(&ArchetypeStats::bytesUsed);
+        for (const auto& set : sparseSets) total += set.bytesUsed;
+        return total;
+    }
+    size_t bytesReserved() const {
+        size_t total = sum(&ArchetypeStats::bytesReserved);
+        for (const auto& set : sparseSets) total += set.bytesReserved();
+        return total;
+    }
+    size_t slack() const { return bytesReserved() - bytesUsed(); }
+    // Index bytes of all sparse sets.
+    size_t sparseIndexBytes() const {
+        size_t total = 0;
+        for (const auto& set : sparseSets) total += set.indexBytes;
+        return total;
+    }
+    // Part of bytesTotal still shared with a cloned world: chunks and index pages.
+    size_t bytesShared() const { return sum(&ArchetypeStats::bytesShared) + indexBytesShared; }
+    // Everything the world allocated for its data: columns, their overhead, sparse sets and the
+    // indexes.
+    size_t bytesTotal() const {
+        return bytesReserved() + sum(&ArchetypeStats::bytesOverhead) + indexBytes +
+               sparseIndexBytes();
+    }
+
+    // One line per archetype followed by its columns, one per sparse set, then the world totals.
+    std::string toTable() const {
+        std::ostringstream out;
+        writeRow(out, "archetype", "column", "rows", "used", "reserved", "slack", "shared");
+        for (const auto& arch : archetypes) {
+            writeRow(out, std::to_string(arch.signature), "*", std::to_string(arch.rows),
+                     std::to_string(arch.bytesUsed()), std::to_string(arch.bytesReserved()),
+                     std::to_string(arch.slack()), "");
+            writeColumnRow(out, "entity", arch.entities);
+            for (const auto& column : arch.columns) {
+                writeColumnRow(out, std::to_string(column.component), column);
+            }
+        }
+        for (const auto& set : sparseSets) {
+            writeRow(out, "sparse", std::to_string(set.component), std::to_string(set.members),
+                     std::to_string(set.bytesUsed), std::to_string(set.bytesReserved()),
+                     std::to_string(set.slack()), "");
+        }
+        out << "total: " << entities << " entities, " << archetypes.size() << " archetypes, "
+            << bytesUsed() << " used, " << bytesReserved() << " reserved, " << slack()
+            << " slack, " << indexBytes << " index, " << sparseIndexBytes() << " sparse index, "
+            << bytesTotal() << " bytes total\n";
+        return out.str();
+    }
+
+    std::string toJson() const {
+        std::ostringstream out;
+        out << "{\"entities\":" << entities << ",\"indexPages\":" << indexPages
+            << ",\"indexBytes\":" << indexBytes << ",\"indexBytesShared\":" << indexBytesShared
+            << ",\"bytesUsed\":" << bytesUsed()
+            << ",\"bytesReserved\":" << bytesReserved() << ",\"slack\":" << slack()
+            << ",\"bytesTotal\":" << bytesTotal() << ",\"archetypes\":[";
+        for (size_t a = 0; a < archetypes.size(); ++a) {
+            const auto& arch = archetypes[a];
+            if (a > 0) out << ',';
+            out << "{\"signature\":" << arch.signature << ",\"rows\":" << arch.rows
+                << ",\"bytesUsed\":" << arch.bytesUsed()
+                << ",\"bytesReserved\":" << arch.bytesReserved() << ",\"slack\":" << arch.slack()
+                << ",\"entities\":";
+            writeColumnJson(out, arch.entities);
+            out << ",\"columns\":[";
+            for (size_t c = 0; c < arch.columns.size(); ++c) {
+                if (c > 0) out << ',';
+                writeColumnJson(out, arch.columns[c]);
+            }
+            out << "]}";
+        }
+        out << "],\"sparseSets\":[";
+        for (size_t s = 0; s < sparseSets.size(); ++s) {
+            const auto& set = sparseSets[s];
+            if (s > 0) out << ',';
+            out << "{\"component\":" << set.component << ",\"elementSize\":" << set.elementSize
+                << ",\"members\":" << set.members << ",\"bytesUsed\":" << set.bytesUsed
+                << ",\"valueBytes\":" << set.valueBytes << ",\"idBytes\":" << set.idBytes
+                << ",\"bytesReserved\":" << set.bytesReserved() << ",\"slack\":" << set.slack()
+                << ",\"indexPages\":" << set.indexPages << ",\"indexBytes\":" << set.indexBytes
+                << '}';
+        }
+        out << "]}";
+        return out.str();
+    }
+
+   private:
+    size_t sum(size_t (ArchetypeStats::*field)() const) const {
+        size_t total = 0;
+        for (const auto& arch : archetypes) total += (arch.*field)();
+        return total;
+    }
+
+    static void writeRow(std::ostringstream& out, const std::string& archetype,
+                         const std::string& column, const std::string& rows,
+                         const std::string& used, const std::string& reserved,
+                         const std::string& slack, const std::string& shared) {
+        out << std::left << std::setw(12) << archetype << std::setw(10) << column << std::right
+            << std::setw(10) << rows << std::setw(14) << used << std::setw(14) << reserved
+            << std::setw(14) << slack << std::setw(12) << shared << '\n';
+    }
+
+    static void writeColumnRow(std::ostringstream& out, const std::string& name,
+                               const ColumnStats& column) {
+        writeRow(out, "", name, std::to_string(column.rows), std::to_string(column.bytesUsed),
+                 std::to_string(column.bytesReserved), std::to_string(column.slack()),
+                 std::to_string(column.sharedChunks) + "/" + std::to_string(column.chunks));
+    }
+
+    static void writeColumnJson(std::ostringstream& out, const ColumnStats& column) {
+        out << "{\"component\":" << column.component << ",\"elementSize\":" << column.elementSize
+            << ",\"rows\":" << column.rows << ",\"chunks\":" << column.chunks
+            << ",\"sharedChunks\":" << column.sharedChunks << ",\"bytesUsed\":" << column.bytesUsed
+            << ",\"bytesReserved\":" << column.bytesReserved
+            << ",\"bytesShared\":" << column.bytesShared
+            << ",\"bytesOverhead\":" << column.bytesOverhead << ",\"slack\":" << column.slack()
+            << '}';
+    }
+};
+
+}  // namespace ecs
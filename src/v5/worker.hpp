@@ -0,0 +1,120 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace ecs {
+
+namespace detail {
+
+// Pins the calling thread to the index-th CPU the process may run on, modulo their number.
+// Does nothing where the platform has no thread affinity or pinning fails.
+inline void pinThread(size_t index) {
+#if defined(__linux__)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+    size_t count = static_cast<size_t>(CPU_COUNT(&allowed));
+    if (count == 0) return;
+    size_t skip = index % count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed) || skip-- > 0) continue;
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+        return;
+    }
+#else
+    (void)index;
+#endif
+}
+
+// A thread that lives as long as the object and runs the jobs posted to it, one at a time. Used
+// where a std::async per job would start a thread per frame.
+class Worker {
+   public:
+    // cpu: pin the thread with pinThread(*cpu)
+    explicit Worker(std::optional<size_t> cpu = std::nullopt)
+        : thread([this, cpu] {
+              if (cpu) pinThread(*cpu);
+              loop();
+          }) {}
+
+    Worker(const Worker&) = delete;
+    Worker& operator=(const Worker&) = delete;
+
+    // Finishes the posted job and ends the thread.
+    ~Worker() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        posted.notify_one();
+        thread.join();
+    }
+
+    // Runs job on the thread. Call wait before posting the next one.
+    void post(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            this->job = std::move(job);
+            busy = true;
+        }
+        posted.notify_one();
+    }
+
+    // Waits until the posted job finished. Returns the exception it threw, null if none.
+    std::exception_ptr wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return !busy; });
+        return std::exchange(failure, nullptr);
+    }
+
+    std::thread::id id() const { return thread.get_id(); }
+
+   private:
+    std::mutex mutex;
+    std::condition_variable posted;
+    std::condition_variable finished;
+    std::function<void()> job;
+    bool busy = false;
+    bool stopping = false;
+    std::exception_ptr failure;
+    // Last, it starts once the members above exist
+    std::thread thread;
+
+    void loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            posted.wait(lock, [this] { return busy || stopping; });
+            if (!busy) return;
+            auto current = std::exchange(job, nullptr);
+            lock.unlock();
+            std::exception_ptr error;
+            try {
+                current();
+            } catch (...) {
+                error = std::current_exception();
+            }
+            lock.lock();
+            failure = error;
+            busy = false;
+            finished.notify_all();
+        }
+    }
+};
+
+}  // namespace detail
+
+}  // namespace ecs